@@ -71,6 +71,7 @@ static int do_count_frames = 0;
 static int do_count_packets = 0;
 static int do_read_frames  = 0;
 static int do_read_packets = 0;
+static int do_skip_decoders = 0;
 static int do_show_chapters = 0;
 static int do_show_error   = 0;
 static int do_show_format  = 0;
@@ -227,7 +228,8 @@ static struct section sections[] = {
 static const OptionDef *options;
 
 /* FFprobe context */
-static const char *input_filename;
+static const char **input_filenames;
+static int nb_input_filenames;
 static AVInputFormat *iformat = NULL;
 
 static struct AVHashContext *hash;
@@ -261,6 +263,7 @@ static void ffprobe_cleanup(int ret)
     int i;
     for (i = 0; i < FF_ARRAY_ELEMS(sections); i++)
         av_dict_free(&(sections[i].entries_to_show));
+    av_freep(&input_filenames);
 }
 
 struct unit_value {
@@ -2116,8 +2119,13 @@ static int read_interval_packets(WriterContext *w, InputFile *ifile,
                 nb_streams_packets[pkt.stream_index]++;
             }
             if (do_read_frames) {
-                pkt1 = pkt;
-                while (pkt1.size && process_frame(w, ifile, frame, &pkt1) > 0);
+                /* without decoders, every demuxed packet is one frame */
+                if (do_skip_decoders) {
+                    nb_streams_frames[pkt.stream_index]++;
+                } else {
+                    pkt1 = pkt;
+                    while (pkt1.size && process_frame(w, ifile, frame, &pkt1) > 0);
+                }
             }
         }
         av_packet_unref(&pkt);
@@ -2599,6 +2607,9 @@ static int open_input_file(InputFile *ifile, const char *filename)
 
         ist->st = stream;
 
+        if (do_skip_decoders)
+            continue;
+
         if (stream->codecpar->codec_id == AV_CODEC_ID_PROBE) {
             av_log(NULL, AV_LOG_WARNING,
                    "Failed to probe codec for input stream %d\n",
@@ -2955,15 +2966,10 @@ static int opt_show_format_entry(void *optctx, const char *opt, const char *arg)
 
 static void opt_input_file(void *optctx, const char *arg)
 {
-    if (input_filename) {
-        av_log(NULL, AV_LOG_ERROR,
-                "Argument '%s' provided as input filename, but '%s' was already specified.\n",
-                arg, input_filename);
-        exit_program(1);
-    }
     if (!strcmp(arg, "-"))
         arg = "pipe:";
-    input_filename = arg;
+    GROW_ARRAY(input_filenames, nb_input_filenames);
+    input_filenames[nb_input_filenames - 1] = arg;
 }
 
 static int opt_input_file_i(void *optctx, const char *opt, const char *arg)
@@ -3215,6 +3221,7 @@ static const OptionDef real_options[] = {
     { "show_chapters", 0, {(void*)&opt_show_chapters}, "show chapters info" },
     { "count_frames", OPT_BOOL, {(void*)&do_count_frames}, "count the number of frames per stream" },
     { "count_packets", OPT_BOOL, {(void*)&do_count_packets}, "count the number of packets per stream" },
+    { "skip_decoders", OPT_BOOL, {(void*)&do_skip_decoders}, "do not open decoders, count demuxed packets as frames" },
     { "show_program_version",  0, {(void*)&opt_show_program_version},  "show ffprobe version" },
     { "show_library_versions", 0, {(void*)&opt_show_library_versions}, "show library versions" },
     { "show_versions",         0, {(void*)&opt_show_versions}, "show program and library versions" },
@@ -3245,10 +3252,42 @@ static inline int check_section_show_entries(int section_id)
             do_show_##varname = 1;                                      \
     } while (0)
 
+/* write one output document, probing filename if not NULL */
+static int probe_document(const Writer *w, const char *w_args, const char *filename)
+{
+    WriterContext *wctx;
+    int ret;
+
+    if ((ret = writer_open(&wctx, w, w_args,
+                           sections, FF_ARRAY_ELEMS(sections))) < 0)
+        return ret;
+
+    if (w == &xml_writer)
+        wctx->string_validation_utf8_flags |= AV_UTF8_FLAG_EXCLUDE_XML_INVALID_CONTROL_CODES;
+
+    writer_print_section_header(wctx, SECTION_ID_ROOT);
+
+    if (do_show_program_version)
+        ffprobe_show_program_version(wctx);
+    if (do_show_library_versions)
+        ffprobe_show_library_versions(wctx);
+    if (do_show_pixel_formats)
+        ffprobe_show_pixel_formats(wctx);
+
+    if (filename) {
+        ret = probe_file(wctx, filename);
+        if (ret < 0 && do_show_error)
+            show_error(wctx, ret);
+    }
+
+    writer_print_section_footer(wctx);
+    writer_close(&wctx);
+    return ret;
+}
+
 int main(int argc, char **argv)
 {
     const Writer *w;
-    WriterContext *wctx;
     char *buf;
     char *w_name = NULL, *w_args = NULL;
     int ret, i;
@@ -3341,40 +3380,38 @@ int main(int argc, char **argv)
         goto end;
     }
 
-    if ((ret = writer_open(&wctx, w, w_args,
-                           sections, FF_ARRAY_ELEMS(sections))) >= 0) {
-        if (w == &xml_writer)
-            wctx->string_validation_utf8_flags |= AV_UTF8_FLAG_EXCLUDE_XML_INVALID_CONTROL_CODES;
-
-        writer_print_section_header(wctx, SECTION_ID_ROOT);
-
-        if (do_show_program_version)
-            ffprobe_show_program_version(wctx);
-        if (do_show_library_versions)
-            ffprobe_show_library_versions(wctx);
-        if (do_show_pixel_formats)
-            ffprobe_show_pixel_formats(wctx);
-
-        if (!input_filename &&
-            ((do_show_format || do_show_programs || do_show_streams || do_show_chapters || do_show_packets || do_show_error) ||
-             (!do_show_program_version && !do_show_library_versions && !do_show_pixel_formats))) {
-            show_usage();
-            av_log(NULL, AV_LOG_ERROR, "You have to specify one input file.\n");
-            av_log(NULL, AV_LOG_ERROR, "Use -h to get full help or, even better, run 'man %s'.\n", program_name);
-            ret = AVERROR(EINVAL);
-        } else if (input_filename) {
-            ret = probe_file(wctx, input_filename);
-            if (ret < 0 && do_show_error)
-                show_error(wctx, ret);
-        }
+    if (do_skip_decoders && do_show_frames) {
+        av_log(NULL, AV_LOG_ERROR,
+               "-skip_decoders and -show_frames options are incompatible\n");
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
 
-        writer_print_section_footer(wctx);
-        writer_close(&wctx);
+    if (!nb_input_filenames &&
+        ((do_show_format || do_show_programs || do_show_streams || do_show_chapters || do_show_packets || do_show_error) ||
+         (!do_show_program_version && !do_show_library_versions && !do_show_pixel_formats))) {
+        show_usage();
+        av_log(NULL, AV_LOG_ERROR, "You have to specify one input file.\n");
+        av_log(NULL, AV_LOG_ERROR, "Use -h to get full help or, even better, run 'man %s'.\n", program_name);
+        ret = AVERROR(EINVAL);
+        goto end;
     }
 
+    /* each input gets its own output document */
+    ret = 0;
+    i   = 0;
+    do {
+        int probe_ret;
+
+        probe_ret = probe_document(w, w_args, nb_input_filenames ? input_filenames[i] : NULL);
+        if (probe_ret < 0 && ret >= 0)
+            ret = probe_ret;
+    } while (++i < nb_input_filenames);
+
 end:
     av_freep(&print_format);
     av_freep(&read_intervals);
+    av_freep(&input_filenames);
     av_hash_freep(&hash);
 
     uninit_opts();
@@ -23,6 +23,8 @@
  * multiple format streaming server based on the FFmpeg libraries
  */
 
+#define _GNU_SOURCE     /* Needed for splice() with glibc */
+
 #include "config.h"
 #if !HAVE_CLOSESOCKET
 #define closesocket close
@@ -63,6 +65,9 @@
 #if HAVE_POLL_H
 #include <poll.h>
 #endif
+#if HAVE_EPOLL_CREATE1
+#include <sys/epoll.h>
+#endif
 #include <errno.h>
 #include <time.h>
 #include <sys/wait.h>
@@ -133,12 +138,21 @@ typedef struct HTTPContext {
     int fd; /* socket file descriptor */
     struct sockaddr_in from_addr; /* origin */
     struct pollfd *poll_entry; /* used when polling */
+#if HAVE_EPOLL_CREATE1
+    struct pollfd epoll_entry; /* poll entry filled by epoll_wait() */
+    int epoll_registered; /* fd is in the epoll set */
+#endif
     int64_t timeout;
     uint8_t *buffer_ptr, *buffer_end;
     int http_error;
     int post;
     int chunked_encoding;
     int chunk_size;               /* 0 if it needs to be read */
+#if HAVE_SPLICE
+    int feed_splice;              /* feed packets are spliced through feed_pipe */
+    int feed_pipe[2];
+    int feed_pipe_len;            /* bytes of the current packet in feed_pipe */
+#endif
     struct HTTPContext *next;
     int got_key_frame; /* stream 0 => 1, stream 1 => 2, stream 2=> 4 */
     int64_t data_count;
@@ -261,6 +275,11 @@ static uint64_t current_bandwidth;
 /* Making this global saves on passing it around everywhere */
 static int64_t cur_time;
 
+#if HAVE_EPOLL_CREATE1
+/* epoll instance replacing poll(), -1 if unavailable */
+static int epoll_fd = -1;
+#endif
+
 static AVLFG random_state;
 
 static FILE *logfile = NULL;
@@ -650,6 +669,56 @@ static void start_multicast(void)
     }
 }
 
+#if HAVE_EPOLL_CREATE1
+/* Bring the epoll registration of fd in line with the requested poll
+ * events (0 to remove it). The kernel keeps the set between iterations,
+ * so a syscall is only needed when a connection changes state. */
+static int epoll_update(int fd, struct pollfd *entry, int *registered,
+                        short events)
+{
+    struct epoll_event ev = { 0 };
+
+    entry->fd      = fd;
+    entry->revents = 0;
+    if (!events) {
+        if (!*registered)
+            return 0;
+        *registered = 0;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL) < 0)
+            return AVERROR(errno);
+        return 0;
+    }
+    if (*registered && entry->events == events)
+        return 0;
+
+    ev.events   = (events & POLLIN  ? EPOLLIN  : 0) |
+                  (events & POLLOUT ? EPOLLOUT : 0);
+    ev.data.ptr = entry;
+    if (epoll_ctl(epoll_fd, *registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                  fd, &ev) < 0)
+        return AVERROR(errno);
+    entry->events = events;
+    *registered   = 1;
+    return 0;
+}
+
+/* wait like poll() does, storing the returned events in the poll entries
+ * registered with epoll_update() */
+static int epoll_poll(struct epoll_event *events, int max_events, int delay)
+{
+    int i, ret = epoll_wait(epoll_fd, events, max_events, delay);
+
+    for (i = 0; i < ret; i++) {
+        struct pollfd *entry = events[i].data.ptr;
+        entry->revents = (events[i].events & EPOLLIN  ? POLLIN  : 0) |
+                         (events[i].events & EPOLLOUT ? POLLOUT : 0) |
+                         (events[i].events & EPOLLERR ? POLLERR : 0) |
+                         (events[i].events & EPOLLHUP ? POLLHUP : 0);
+    }
+    return ret;
+}
+#endif
+
 /* main loop of the HTTP server */
 static int http_server(void)
 {
@@ -657,6 +726,10 @@ static int http_server(void)
     int ret, delay;
     struct pollfd *poll_table, *poll_entry;
     HTTPContext *c, *c_next;
+#if HAVE_EPOLL_CREATE1
+    struct epoll_event *epoll_events = NULL;
+    int registered;
+#endif
 
     poll_table = av_mallocz_array(config.nb_max_http_connections + 2,
                                   sizeof(*poll_table));
@@ -685,6 +758,29 @@ static int http_server(void)
         goto quit;
     }
 
+#if HAVE_EPOLL_CREATE1
+    epoll_events = av_malloc_array(config.nb_max_http_connections + 2,
+                                   sizeof(*epoll_events));
+    if (epoll_events)
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd >= 0) {
+        /* the listening sockets keep the first entries of the poll table */
+        poll_entry = poll_table;
+        if (server_fd) {
+            registered = 0;
+            if (epoll_update(server_fd, poll_entry++, &registered, POLLIN) < 0)
+                goto quit;
+        }
+        if (rtsp_server_fd) {
+            registered = 0;
+            if (epoll_update(rtsp_server_fd, poll_entry++, &registered, POLLIN) < 0)
+                goto quit;
+        }
+    } else {
+        av_log(NULL, AV_LOG_WARNING, "epoll unavailable, using poll()\n");
+    }
+#endif
+
     http_log("FFserver started.\n");
 
     start_children(config.first_feed);
@@ -708,16 +804,12 @@ static int http_server(void)
         c = first_http_ctx;
         delay = 1000;
         while (c) {
-            int fd;
-            fd = c->fd;
+            short events = 0;
             switch(c->state) {
             case HTTPSTATE_SEND_HEADER:
             case RTSPSTATE_SEND_REPLY:
             case RTSPSTATE_SEND_PACKET:
-                c->poll_entry = poll_entry;
-                poll_entry->fd = fd;
-                poll_entry->events = POLLOUT;
-                poll_entry++;
+                events = POLLOUT;
                 break;
             case HTTPSTATE_SEND_DATA_HEADER:
             case HTTPSTATE_SEND_DATA:
@@ -725,10 +817,7 @@ static int http_server(void)
                 if (!c->is_packetized) {
                     /* for TCP, we output as much as we can
                      * (may need to put a limit) */
-                    c->poll_entry = poll_entry;
-                    poll_entry->fd = fd;
-                    poll_entry->events = POLLOUT;
-                    poll_entry++;
+                    events = POLLOUT;
                 } else {
                     /* when ffserver is doing the timing, we work by
                      * looking at which packet needs to be sent every
@@ -742,21 +831,41 @@ static int http_server(void)
             case HTTPSTATE_WAIT_FEED:
             case RTSPSTATE_WAIT_REQUEST:
                 /* need to catch errors */
-                c->poll_entry = poll_entry;
-                poll_entry->fd = fd;
-                poll_entry->events = POLLIN;/* Maybe this will work */
-                poll_entry++;
+                events = POLLIN;/* Maybe this will work */
                 break;
             default:
-                c->poll_entry = NULL;
                 break;
             }
+#if HAVE_EPOLL_CREATE1
+            if (epoll_fd >= 0) {
+                c->poll_entry = events ? &c->epoll_entry : NULL;
+                /* let handle_connection() drop it if it cannot be watched */
+                if (epoll_update(c->fd, &c->epoll_entry,
+                                 &c->epoll_registered, events) < 0)
+                    c->epoll_entry.revents = POLLERR;
+            } else
+#endif
+            if (events) {
+                c->poll_entry = poll_entry;
+                poll_entry->fd = c->fd;
+                poll_entry->events = events;
+                poll_entry++;
+            } else {
+                c->poll_entry = NULL;
+            }
             c = c->next;
         }
 
         /* wait for an event on one connection. We poll at least every
          * second to handle timeouts */
         do {
+#if HAVE_EPOLL_CREATE1
+            if (epoll_fd >= 0) {
+                poll_table[0].revents = poll_table[1].revents = 0;
+                ret = epoll_poll(epoll_events,
+                                 config.nb_max_http_connections + 2, delay);
+            } else
+#endif
             ret = poll(poll_table, poll_entry - poll_table, delay);
             if (ret < 0 && ff_neterrno() != AVERROR(EAGAIN) &&
                 ff_neterrno() != AVERROR(EINTR)) {
@@ -796,6 +905,12 @@ static int http_server(void)
     }
 
 quit:
+#if HAVE_EPOLL_CREATE1
+    if (epoll_fd >= 0)
+        close(epoll_fd);
+    epoll_fd = -1;
+    av_free(epoll_events);
+#endif
     av_free(poll_table);
     return -1;
 }
@@ -908,6 +1023,11 @@ static void close_connection(HTTPContext *c)
     }
 
     /* remove connection associated resources */
+#if HAVE_EPOLL_CREATE1
+    /* forked feeders may share the socket, so closing it is not enough */
+    if (c->epoll_registered)
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+#endif
     if (c->fd >= 0)
         closesocket(c->fd);
     if (c->fmt_in) {
@@ -960,6 +1080,12 @@ static void close_connection(HTTPContext *c)
         c->stream->feed_opened = 0;
         close(c->feed_fd);
     }
+#if HAVE_SPLICE
+    if (c->feed_splice) {
+        close(c->feed_pipe[0]);
+        close(c->feed_pipe[1]);
+    }
+#endif
 
     av_freep(&c->pb_buffer);
     av_freep(&c->packet_buffer);
@@ -2680,6 +2806,63 @@ static int http_start_receive_data(HTTPContext *c)
     return 0;
 }
 
+static int feed_packet_complete(HTTPContext *c)
+{
+#if HAVE_SPLICE
+    if (c->feed_splice)
+        return c->feed_pipe_len == FFM_PACKET_SIZE;
+#endif
+    return c->buffer_ptr >= c->buffer_end;
+}
+
+/* write the received packet at the write index of the feed file */
+static int feed_write_packet(HTTPContext *c)
+{
+    FFServerStream *feed = c->stream;
+    int ret;
+
+#if HAVE_SPLICE
+    if (c->feed_splice) {
+        loff_t pos = feed->feed_write_index;
+        uint8_t sync[2];
+
+        /* move the packet from the socket to the page cache without
+         * copying it through user space */
+        while (c->feed_pipe_len > 0) {
+            ssize_t len = splice(c->feed_pipe[0], NULL, c->feed_fd, &pos,
+                                 c->feed_pipe_len, SPLICE_F_MOVE);
+            if (len < 0 && errno == EINTR)
+                continue;
+            if (len <= 0) {
+                ret = len < 0 ? AVERROR(errno) : AVERROR(EIO);
+                http_log("Error writing to feed file: %s\n", av_err2str(ret));
+                return ret;
+            }
+            c->feed_pipe_len -= len;
+        }
+
+        if (pread(c->feed_fd, sync, 2, feed->feed_write_index) != 2 ||
+            sync[0] != 'f' || sync[1] != 'm') {
+            http_log("Feed stream has become desynchronized -- disconnecting\n");
+            return AVERROR_INVALIDDATA;
+        }
+        return 0;
+    }
+#endif
+
+    /* XXX: use llseek or url_seek
+     * XXX: Should probably fail? */
+    if (lseek(c->feed_fd, feed->feed_write_index, SEEK_SET) == -1)
+        http_log("Seek to %"PRId64" failed\n", feed->feed_write_index);
+
+    if (write(c->feed_fd, c->buffer, FFM_PACKET_SIZE) < 0) {
+        ret = AVERROR(errno);
+        http_log("Error writing to feed file: %s\n", strerror(errno));
+        return ret;
+    }
+    return 0;
+}
+
 static int http_receive_data(HTTPContext *c)
 {
     HTTPContext *c1;
@@ -2716,6 +2899,13 @@ static int http_receive_data(HTTPContext *c)
     }
 
     if (c->buffer_end > c->buffer_ptr) {
+#if HAVE_SPLICE
+        if (c->feed_splice)
+            len = splice(c->fd, NULL, c->feed_pipe[1], NULL,
+                         FFMIN(c->chunk_size, FFM_PACKET_SIZE - c->feed_pipe_len),
+                         SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        else
+#endif
         len = recv(c->fd, c->buffer_ptr,
                    FFMIN(c->chunk_size, c->buffer_end - c->buffer_ptr), 0);
         if (len < 0) {
@@ -2729,12 +2919,21 @@ static int http_receive_data(HTTPContext *c)
         else {
             av_assert0(len <= c->chunk_size);
             c->chunk_size -= len;
+#if HAVE_SPLICE
+            if (c->feed_splice)
+                c->feed_pipe_len += len;
+            else
+#endif
             c->buffer_ptr += len;
             c->data_count += len;
             update_datarate(&c->datarate, c->data_count);
         }
     }
 
+#if HAVE_SPLICE
+    /* spliced packets are checked once they are in the feed file */
+    if (!c->feed_splice)
+#endif
     if (c->buffer_ptr - c->buffer >= 2 && c->data_count > FFM_PACKET_SIZE) {
         if (c->buffer[0] != 'f' ||
             c->buffer[1] != 'm') {
@@ -2743,20 +2942,13 @@ static int http_receive_data(HTTPContext *c)
         }
     }
 
-    if (c->buffer_ptr >= c->buffer_end) {
+    if (feed_packet_complete(c)) {
         FFServerStream *feed = c->stream;
         /* a packet has been received : write it in the store, except
          * if header */
         if (c->data_count > FFM_PACKET_SIZE) {
-            /* XXX: use llseek or url_seek
-             * XXX: Should probably fail? */
-            if (lseek(c->feed_fd, feed->feed_write_index, SEEK_SET) == -1)
-                http_log("Seek to %"PRId64" failed\n", feed->feed_write_index);
-
-            if (write(c->feed_fd, c->buffer, FFM_PACKET_SIZE) < 0) {
-                http_log("Error writing to feed file: %s\n", strerror(errno));
+            if (feed_write_packet(c) < 0)
                 goto fail;
-            }
 
             feed->feed_write_index += FFM_PACKET_SIZE;
             /* update file size */
@@ -2826,6 +3018,13 @@ static int http_receive_data(HTTPContext *c)
 
             avformat_close_input(&s);
             av_freep(&pb);
+
+#if HAVE_SPLICE
+            /* the following packets only need to be stored, so keep them
+             * out of user space if possible */
+            if (pipe(c->feed_pipe) >= 0)
+                c->feed_splice = 1;
+#endif
         }
         c->buffer_ptr = c->buffer;
     }
@@ -168,7 +168,7 @@ typedef struct AC3EncodeContext {
     AVFloatDSPContext *fdsp;
     MECmpContext mecc;
     AC3DSPContext ac3dsp;                   ///< AC-3 optimized functions
-    FFTContext mdct;                        ///< FFT context for MDCT calculation
+    FFTContext mdct[AC3_MAX_CHANNELS];      ///< FFT contexts for MDCT calculation, one per channel
     const SampleType *mdct_window;          ///< MDCT window function array
 
     AC3Block blocks[AC3_MAX_BLOCKS];        ///< per-block info
@@ -233,7 +233,7 @@ typedef struct AC3EncodeContext {
     int frame_bits;                         ///< all frame bits except exponents and mantissas
     int exponent_bits;                      ///< number of bits used for exponents
 
-    SampleType *windowed_samples;
+    SampleType *windowed_samples;           ///< windowed input, AC3_WINDOW_SIZE samples per channel
     SampleType **planar_samples;
     uint8_t *bap_buffer;
     uint8_t *bap1_buffer;
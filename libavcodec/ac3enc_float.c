@@ -53,7 +53,10 @@ static const AVClass ac3enc_class = {
  */
 av_cold void ff_ac3_float_mdct_end(AC3EncodeContext *s)
 {
-    ff_mdct_end(&s->mdct);
+    int ch;
+
+    for (ch = 0; ch < s->channels; ch++)
+        ff_mdct_end(&s->mdct[ch]);
     av_freep(&s->mdct_window);
 }
 
@@ -67,7 +70,7 @@ av_cold void ff_ac3_float_mdct_end(AC3EncodeContext *s)
 av_cold int ff_ac3_float_mdct_init(AC3EncodeContext *s)
 {
     float *window;
-    int i, n, n2;
+    int ch, i, n, n2, ret;
 
     n  = 1 << 9;
     n2 = n >> 1;
@@ -82,7 +85,12 @@ av_cold int ff_ac3_float_mdct_init(AC3EncodeContext *s)
         window[n-1-i] = window[i];
     s->mdct_window = window;
 
-    return ff_mdct_init(&s->mdct, 9, 0, -2.0 / n);
+    for (ch = 0; ch < s->channels; ch++) {
+        ret = ff_mdct_init(&s->mdct[ch], 9, 0, -2.0 / n);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
 }
 
 
@@ -90,7 +98,7 @@ av_cold int ff_ac3_float_mdct_init(AC3EncodeContext *s)
  * Normalize the input samples.
  * Not needed for the floating-point encoder.
  */
-static int normalize_samples(AC3EncodeContext *s)
+static int normalize_samples(AC3EncodeContext *s, float *windowed_samples)
 {
     return 0;
 }
@@ -154,6 +162,7 @@ AVCodec ff_ac3_encoder = {
     .init            = ff_ac3_float_encode_init,
     .encode2         = ff_ac3_float_encode_frame,
     .close           = ff_ac3_encode_close,
+    .capabilities    = AV_CODEC_CAP_SLICE_THREADS,
     .sample_fmts     = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_FLTP,
                                                       AV_SAMPLE_FMT_NONE },
     .priv_class      = &ac3enc_class,
@@ -112,19 +112,15 @@ void dnxhd_10bit_get_pixels_8x4_sym(int16_t *av_restrict block,
     memcpy(block + 4 * 8, pixels + 3 * line_size, 8 * sizeof(*block));
 }
 
-static int dnxhd_10bit_dct_quantize(MpegEncContext *ctx, int16_t *block,
-                                    int n, int qscale, int *overflow)
+static av_always_inline
+int dnxhd_10bit_quantize(MpegEncContext *ctx, int16_t *block,
+                         int n, int qscale)
 {
     const uint8_t *scantable= ctx->intra_scantable.scantable;
     const int *qmat = n<4 ? ctx->q_intra_matrix[qscale] : ctx->q_chroma_intra_matrix[qscale];
     int last_non_zero = 0;
     int i;
 
-    ctx->fdsp.fdct(block);
-
-    // Divide by 4 with rounding, to compensate scaling of DCT coefficients
-    block[0] = (block[0] + 2) >> 2;
-
     for (i = 1; i < 64; ++i) {
         int j = scantable[i];
         int sign = FF_SIGNBIT(block[j]);
@@ -143,6 +139,22 @@ static int dnxhd_10bit_dct_quantize(MpegEncContext *ctx, int16_t *block,
     return last_non_zero;
 }
 
+static av_always_inline void dnxhd_10bit_fdct(MpegEncContext *ctx, int16_t *block)
+{
+    ctx->fdsp.fdct(block);
+
+    // Divide by 4 with rounding, to compensate scaling of DCT coefficients
+    block[0] = (block[0] + 2) >> 2;
+}
+
+static int dnxhd_10bit_dct_quantize(MpegEncContext *ctx, int16_t *block,
+                                    int n, int qscale, int *overflow)
+{
+    dnxhd_10bit_fdct(ctx, block);
+
+    return dnxhd_10bit_quantize(ctx, block, n, qscale);
+}
+
 static av_cold int dnxhd_init_vlc(DNXHDEncContext *ctx)
 {
     int i, j, level, run;
@@ -765,6 +777,86 @@ static int dnxhd_calc_bits_thread(AVCodecContext *avctx, void *arg,
     return 0;
 }
 
+/**
+ * Compute the bits and distortion of every macroblock in a row for all
+ * qscales at once. The DCT of 10-bit blocks does not depend on qscale,
+ * so it is only done once per block instead of once per qscale.
+ * Quantized levels never grow with qscale, so once all AC coefficients
+ * of a block quantize to zero the result is reused for higher qscales.
+ */
+static int dnxhd_10bit_calc_bits_thread(AVCodecContext *avctx, void *arg,
+                                        int jobnr, int threadnr)
+{
+    DNXHDEncContext *ctx = avctx->priv_data;
+    int mb_y = jobnr, mb_x, q;
+    LOCAL_ALIGNED_16(int16_t, dct,   [8], [64]);
+    LOCAL_ALIGNED_16(int16_t, block, [64]);
+    ctx = ctx->thread[threadnr];
+
+    ctx->m.last_dc[0] =
+    ctx->m.last_dc[1] =
+    ctx->m.last_dc[2] = 1 << (ctx->cid_table->bit_depth + 2);
+
+    for (mb_x = 0; mb_x < ctx->m.mb_width; mb_x++) {
+        unsigned mb = mb_y * ctx->m.mb_width + mb_x;
+        int dc_only_ssd[8];
+        int dc_bits = 0;
+        int i;
+
+        dnxhd_get_blocks(ctx, mb_x, mb_y);
+
+        for (i = 0; i < 8; i++) {
+            int nbits, diff;
+            int n = dnxhd_switch_matrix(ctx, i);
+
+            dc_only_ssd[i] = -1;
+
+            memcpy(dct[i], ctx->blocks[i], 64 * sizeof(*block));
+            dnxhd_10bit_fdct(&ctx->m, dct[i]);
+
+            diff = dct[i][0] - ctx->m.last_dc[n];
+            if (diff < 0)
+                nbits = av_log2_16bit(-2 * diff);
+            else
+                nbits = av_log2_16bit(2 * diff);
+
+            av_assert1(nbits < ctx->cid_table->bit_depth + 4);
+            dc_bits += ctx->cid_table->dc_bits[nbits] + nbits;
+
+            ctx->m.last_dc[n] = dct[i][0];
+        }
+
+        for (q = 1; q < avctx->qmax; q++) {
+            int ssd     = 0;
+            int ac_bits = 0;
+
+            for (i = 0; i < 8; i++) {
+                int last_index, block_ssd;
+
+                if (dc_only_ssd[i] >= 0) {
+                    ssd += dc_only_ssd[i];
+                    continue;
+                }
+
+                memcpy(block, dct[i], 64 * sizeof(*block));
+                last_index = dnxhd_10bit_quantize(&ctx->m, block, 4 & (2*i), q);
+                ac_bits   += dnxhd_calc_ac_bits(ctx, block, last_index);
+
+                dnxhd_unquantize_c(ctx, block, i, q, last_index);
+                ctx->m.idsp.idct(block);
+                block_ssd = dnxhd_ssd_block(block, ctx->blocks[i]);
+                if (!last_index)
+                    dc_only_ssd[i] = block_ssd;
+                ssd += block_ssd;
+            }
+            ctx->mb_rc[(q * ctx->m.mb_num) + mb].ssd  = ssd;
+            ctx->mb_rc[(q * ctx->m.mb_num) + mb].bits = ac_bits + dc_bits + 12 +
+                                                        8 * ctx->vlc_bits[0];
+        }
+    }
+    return 0;
+}
+
 static int dnxhd_encode_thread(AVCodecContext *avctx, void *arg,
                                int jobnr, int threadnr)
 {
@@ -895,10 +987,15 @@ static int dnxhd_encode_rdo(AVCodecContext *avctx, DNXHDEncContext *ctx)
     int last_lower = INT_MAX, last_higher = 0;
     int x, y, q;
 
-    for (q = 1; q < avctx->qmax; q++) {
-        ctx->qscale = q;
-        avctx->execute2(avctx, dnxhd_calc_bits_thread,
+    if (ctx->cid_table->bit_depth == 10) {
+        avctx->execute2(avctx, dnxhd_10bit_calc_bits_thread,
                         NULL, NULL, ctx->m.mb_height);
+    } else {
+        for (q = 1; q < avctx->qmax; q++) {
+            ctx->qscale = q;
+            avctx->execute2(avctx, dnxhd_calc_bits_thread,
+                            NULL, NULL, ctx->m.mb_height);
+        }
     }
     up_step = down_step = 2 << LAMBDA_FRAC_BITS;
     lambda  = ctx->lambda;
@@ -1162,6 +1259,14 @@ static int dnxhd_encode_picture(AVCodecContext *avctx, AVPacket *pkt,
         return ret;
     buf = pkt->data;
 
+    /* With frame threads, each instance would otherwise start the rate
+     * control search from the last frame it happened to encode, making the
+     * output depend on the scheduling. */
+    if (avctx->internal->frame_thread_encoder) {
+        ctx->qscale = 1;
+        ctx->lambda = 2 << LAMBDA_FRAC_BITS;
+    }
+
     dnxhd_load_picture(ctx, frame);
 
 encode_coding_unit:
@@ -1264,7 +1369,8 @@ AVCodec ff_dnxhd_encoder = {
     .init           = dnxhd_encode_init,
     .encode2        = dnxhd_encode_picture,
     .close          = dnxhd_encode_end,
-    .capabilities   = AV_CODEC_CAP_SLICE_THREADS,
+    .capabilities   = AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_FRAME_THREADS |
+                      AV_CODEC_CAP_INTRA_ONLY,
     .pix_fmts       = (const enum AVPixelFormat[]) {
         AV_PIX_FMT_YUV422P,
         AV_PIX_FMT_YUV422P10,
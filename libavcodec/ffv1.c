@@ -146,9 +146,12 @@ av_cold int ff_ffv1_init_slice_contexts(FFV1Context *f)
                                       sizeof(*fs->sample_buffer));
         fs->sample_buffer32 = av_malloc_array((fs->width + 6), 3 * MAX_PLANES *
                                         sizeof(*fs->sample_buffer32));
-        if (!fs->sample_buffer || !fs->sample_buffer32) {
+        fs->context_buffer = av_malloc_array((fs->width + 6), 2 *
+                                        sizeof(*fs->context_buffer));
+        if (!fs->sample_buffer || !fs->sample_buffer32 || !fs->context_buffer) {
             av_freep(&fs->sample_buffer);
             av_freep(&fs->sample_buffer32);
+            av_freep(&fs->context_buffer);
             av_freep(&f->slice_context[i]);
             goto memfail;
         }
@@ -159,6 +162,7 @@ memfail:
     while(--i >= 0) {
         av_freep(&f->slice_context[i]->sample_buffer);
         av_freep(&f->slice_context[i]->sample_buffer32);
+        av_freep(&f->slice_context[i]->context_buffer);
         av_freep(&f->slice_context[i]);
     }
     return AVERROR(ENOMEM);
@@ -230,6 +234,7 @@ av_cold int ff_ffv1_close(AVCodecContext *avctx)
         }
         av_freep(&fs->sample_buffer);
         av_freep(&fs->sample_buffer32);
+        av_freep(&fs->context_buffer);
     }
 
     av_freep(&avctx->stats_out);
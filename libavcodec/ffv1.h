@@ -110,6 +110,7 @@ typedef struct FFV1Context {
     int colorspace;
     int16_t *sample_buffer;
     int32_t *sample_buffer32;
+    int *context_buffer;                 ///< contexts and residuals of one line
 
     int use32bit;
 
@@ -51,3 +51,37 @@ static inline int RENAME(get_context)(PlaneContext *p, TYPE *src,
                p->quant_table[2][(T - RT) & 0xFF];
 }
 
+/**
+ * Compute the context terms that only depend on the previous lines for a
+ * whole line, get_left_context() adds the terms of the left samples.
+ */
+static inline void RENAME(get_top_contexts)(PlaneContext *p, int *top,
+                                            TYPE *last, TYPE *last2, int w)
+{
+    int x;
+
+    if (p->quant_table[3][127]) {
+        for (x = 0; x < w; x++)
+            top[x] = p->quant_table[1][(last[x - 1] - last[x    ]) & 0xFF] +
+                     p->quant_table[2][(last[x    ] - last[x + 1]) & 0xFF] +
+                     p->quant_table[4][(last2[x]    - last[x    ]) & 0xFF];
+    } else {
+        for (x = 0; x < w; x++)
+            top[x] = p->quant_table[1][(last[x - 1] - last[x    ]) & 0xFF] +
+                     p->quant_table[2][(last[x    ] - last[x + 1]) & 0xFF];
+    }
+}
+
+static inline int RENAME(get_left_context)(PlaneContext *p, int top,
+                                           TYPE *src, TYPE *last)
+{
+    const int LT = last[-1];
+    const int L  = src[-1];
+
+    if (p->quant_table[3][127]) {
+        const int LL = src[-2];
+        return top + p->quant_table[0][(L  - LT) & 0xFF] +
+                     p->quant_table[3][(LL - L ) & 0xFF];
+    } else
+        return top + p->quant_table[0][(L - LT) & 0xFF];
+}
@@ -26,6 +26,7 @@ static av_always_inline void RENAME(decode_line)(FFV1Context *s, int w,
 {
     PlaneContext *const p = &s->plane[plane_index];
     RangeCoder *const c   = &s->c;
+    int *const top        = s->context_buffer;
     int x;
     int run_count = 0;
     int run_mode  = 0;
@@ -44,10 +45,13 @@ static av_always_inline void RENAME(decode_line)(FFV1Context *s, int w,
         return;
     }
 
+    /* sample[1] still holds the line before sample[0] at this point */
+    RENAME(get_top_contexts)(p, top, sample[0], sample[1], w);
+
     for (x = 0; x < w; x++) {
         int diff, context, sign;
 
-        context = RENAME(get_context)(p, sample[1] + x, sample[0] + x, sample[1] + x);
+        context = RENAME(get_left_context)(p, top[x], sample[1] + x, sample[0] + x);
         if (context < 0) {
             context = -context;
             sign    = 1;
@@ -26,6 +26,8 @@ static av_always_inline int RENAME(encode_line)(FFV1Context *s, int w,
 {
     PlaneContext *const p = &s->plane[plane_index];
     RangeCoder *const c   = &s->c;
+    int *const contexts   = s->context_buffer;
+    int *const diffs      = s->context_buffer + w;
     int x;
     int run_index = s->run_index;
     int run_count = 0;
@@ -55,6 +57,8 @@ static av_always_inline int RENAME(encode_line)(FFV1Context *s, int w,
         return 0;
     }
 
+    /* The whole line is known, so derive all contexts and residuals first
+     * and keep the entropy coding loop free of that work. */
     for (x = 0; x < w; x++) {
         int diff, context;
 
@@ -66,7 +70,13 @@ static av_always_inline int RENAME(encode_line)(FFV1Context *s, int w,
             diff    = -diff;
         }
 
-        diff = fold(diff, bits);
+        contexts[x] = context;
+        diffs[x]    = fold(diff, bits);
+    }
+
+    for (x = 0; x < w; x++) {
+        int diff    = diffs[x];
+        int context = contexts[x];
 
         if (s->ac != AC_GOLOMB_RICE) {
             if (s->flags & AV_CODEC_FLAG_PASS1) {
@@ -23,6 +23,7 @@
 #include "libavutil/fifo.h"
 #include "libavutil/avassert.h"
 #include "libavutil/imgutils.h"
+#include "libavutil/opt.h"
 #include "libavutil/thread.h"
 #include "avcodec.h"
 #include "internal.h"
@@ -120,6 +121,16 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
        || !(avctx->codec->capabilities & AV_CODEC_CAP_INTRA_ONLY))
         return 0;
 
+    // these used slice threads only before, frame threads add latency and
+    // memory per thread, so only use them if slice threads are not allowed
+    if (   (avctx->codec_id == AV_CODEC_ID_DNXHD ||
+            avctx->codec_id == AV_CODEC_ID_PRORES)
+        && (avctx->codec->capabilities & AV_CODEC_CAP_SLICE_THREADS)
+        && (avctx->thread_type & FF_THREAD_SLICE)) {
+        avctx->thread_type &= ~FF_THREAD_FRAME;
+        return 0;
+    }
+
     if(   !avctx->thread_count
        && avctx->codec_id == AV_CODEC_ID_MJPEG
        && !(avctx->flags & AV_CODEC_FLAG_QSCALE)) {
@@ -197,7 +208,12 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
         *thread_avctx = *avctx;
         thread_avctx->priv_data = tmpv;
         thread_avctx->internal = NULL;
-        memcpy(thread_avctx->priv_data, avctx->priv_data, avctx->codec->priv_data_size);
+        if (avctx->codec->priv_class) {
+            /* a plain copy would share string and binary options */
+            if (av_opt_copy(thread_avctx->priv_data, avctx->priv_data) < 0)
+                goto fail;
+        } else
+            memcpy(thread_avctx->priv_data, avctx->priv_data, avctx->codec->priv_data_size);
         thread_avctx->thread_count = 1;
         thread_avctx->active_thread_type &= ~FF_THREAD_FRAME;
 
@@ -1407,31 +1407,24 @@ static int encode_frame(AVCodecContext *c, AVFrame *frame)
     return ret;
 }
 
-static int estimate_best_b_count(MpegEncContext *s)
+typedef struct BCountEstimate {
+    MpegEncContext *s;
+    AVCodecContext *ctx[MAX_B_FRAMES + 1]; ///< estimation encoder of each job
+    int nb_jobs, nb_cands;
+    int p_lambda, b_lambda, lambda2;
+    int64_t rd[MAX_B_FRAMES + 1];
+} BCountEstimate;
+
+static int open_b_count_context(MpegEncContext *s, AVCodecContext **pc)
 {
-    AVCodec *codec    = avcodec_find_encoder(s->avctx->codec_id);
     AVCodecContext *c = avcodec_alloc_context3(NULL);
-    const int scale = s->brd_scale;
-    int i, j, out_size, p_lambda, b_lambda, lambda2;
-    int64_t best_rd  = INT64_MAX;
-    int best_b_count = -1;
+    int ret;
 
     if (!c)
         return AVERROR(ENOMEM);
-    av_assert0(scale >= 0 && scale <= 3);
 
-    //emms_c();
-    //s->next_picture_ptr->quality;
-    p_lambda = s->last_lambda_for[AV_PICTURE_TYPE_P];
-    //p_lambda * FFABS(s->avctx->b_quant_factor) + s->avctx->b_quant_offset;
-    b_lambda = s->last_lambda_for[AV_PICTURE_TYPE_B];
-    if (!b_lambda) // FIXME we should do this somewhere else
-        b_lambda = p_lambda;
-    lambda2  = (b_lambda * b_lambda + (1 << FF_LAMBDA_SHIFT) / 2) >>
-               FF_LAMBDA_SHIFT;
-
-    c->width        = s->width  >> scale;
-    c->height       = s->height >> scale;
+    c->width        = s->width  >> s->brd_scale;
+    c->height       = s->height >> s->brd_scale;
     c->flags        = AV_CODEC_FLAG_QSCALE | AV_CODEC_FLAG_PSNR;
     c->flags       |= s->avctx->flags & AV_CODEC_FLAG_QPEL;
     c->mb_decision  = s->avctx->mb_decision;
@@ -1442,8 +1435,135 @@ static int estimate_best_b_count(MpegEncContext *s)
     c->time_base    = s->avctx->time_base;
     c->max_b_frames = s->max_b_frames;
 
-    if (avcodec_open2(c, codec, NULL) < 0)
-        return -1;
+    if ((ret = avcodec_open2(c, s->avctx->codec, NULL)) < 0) {
+        avcodec_free_context(&c);
+        return ret;
+    }
+    *pc = c;
+    return 0;
+}
+
+/**
+ * Clear the motion vectors and macroblock types the previous candidate left
+ * in the estimation encoder. Motion estimation uses them as predictors, so
+ * they would make the estimate depend on the candidates run before.
+ */
+static void reset_b_count_context(AVCodecContext *c)
+{
+    MpegEncContext *s = c->priv_data;
+    const size_t mv_table_size = ((s->mb_height + 2) * s->mb_stride + 1) *
+                                 2 * sizeof(int16_t);
+
+    memset(s->p_mv_table_base,            0, mv_table_size);
+    memset(s->b_forw_mv_table_base,       0, mv_table_size);
+    memset(s->b_back_mv_table_base,       0, mv_table_size);
+    memset(s->b_bidir_forw_mv_table_base, 0, mv_table_size);
+    memset(s->b_bidir_back_mv_table_base, 0, mv_table_size);
+    memset(s->b_direct_mv_table_base,     0, mv_table_size);
+    memset(s->mb_type, 0, s->mb_stride * s->mb_height * sizeof(*s->mb_type));
+}
+
+/**
+ * Encode the downscaled lookahead pictures on c with j B-frames between
+ * the P-frames and compute the rate-distortion cost of that choice.
+ */
+static int estimate_b_count_rd(BCountEstimate *e, AVCodecContext *c,
+                               AVFrame *frame, int j)
+{
+    MpegEncContext *s = e->s;
+    /* the pts a single context used for all candidates in order would
+     * assign, they increase as every context takes its candidates in order */
+    int64_t pts = j * (s->max_b_frames + 2);
+    int64_t rd  = 0;
+    int i, out_size, ret;
+
+    reset_b_count_context(c);
+    c->error[0] = c->error[1] = c->error[2] = 0;
+
+    for (i = 0; i < s->max_b_frames + 2; i++) {
+        int is_p = !i || (i - 1) % (j + 1) == j || i - 1 == s->max_b_frames;
+
+        if ((ret = av_frame_ref(frame, s->tmp_frames[i])) < 0)
+            return ret;
+        frame->pts = pts++;
+        if (!i) {
+            frame->pict_type = AV_PICTURE_TYPE_I;
+            frame->quality   = 1 * FF_QP2LAMBDA;
+        } else {
+            frame->pict_type = is_p ? AV_PICTURE_TYPE_P : AV_PICTURE_TYPE_B;
+            frame->quality   = is_p ? e->p_lambda : e->b_lambda;
+        }
+
+        out_size = encode_frame(c, frame);
+        av_frame_unref(frame);
+        if (out_size < 0)
+            return out_size;
+
+        //rd += (out_size * lambda2) >> FF_LAMBDA_SHIFT;
+        if (i)
+            rd += (out_size * e->lambda2) >> (FF_LAMBDA_SHIFT - 3);
+    }
+
+    /* get the delayed frames */
+    while (out_size) {
+        out_size = encode_frame(c, NULL);
+        if (out_size < 0)
+            return out_size;
+        rd += (out_size * e->lambda2) >> (FF_LAMBDA_SHIFT - 3);
+    }
+
+    rd += c->error[0] + c->error[1] + c->error[2];
+
+    e->rd[j] = rd;
+    return 0;
+}
+
+/**
+ * Evaluate every nb_jobs-th candidate, starting with jobnr, on one encoder
+ * context, so that without slice threads a single context is opened.
+ */
+static int estimate_b_count_thread(AVCodecContext *avctx, void *arg,
+                                   int jobnr, int threadnr)
+{
+    BCountEstimate *e = arg;
+    AVFrame *frame;
+    int j, ret;
+
+    if ((ret = open_b_count_context(e->s, &e->ctx[jobnr])) < 0)
+        return ret;
+
+    frame = av_frame_alloc();
+    if (!frame)
+        return AVERROR(ENOMEM);
+
+    for (j = jobnr; j < e->nb_cands; j += e->nb_jobs)
+        if ((ret = estimate_b_count_rd(e, e->ctx[jobnr], frame, j)) < 0)
+            break;
+
+    av_frame_free(&frame);
+    return ret;
+}
+
+static int estimate_best_b_count(MpegEncContext *s)
+{
+    BCountEstimate e = { s };
+    int rets[MAX_B_FRAMES + 1];
+    const int scale = s->brd_scale;
+    int i, j, ret;
+    int64_t best_rd  = INT64_MAX;
+    int best_b_count = -1;
+
+    av_assert0(scale >= 0 && scale <= 3);
+
+    //emms_c();
+    //s->next_picture_ptr->quality;
+    e.p_lambda = s->last_lambda_for[AV_PICTURE_TYPE_P];
+    //p_lambda * FFABS(s->avctx->b_quant_factor) + s->avctx->b_quant_offset;
+    e.b_lambda = s->last_lambda_for[AV_PICTURE_TYPE_B];
+    if (!e.b_lambda) // FIXME we should do this somewhere else
+        e.b_lambda = e.p_lambda;
+    e.lambda2  = (e.b_lambda * e.b_lambda + (1 << FF_LAMBDA_SHIFT) / 2) >>
+                 FF_LAMBDA_SHIFT;
 
     for (i = 0; i < s->max_b_frames + 2; i++) {
         Picture pre_input, *pre_input_ptr = i ? s->input_picture[i - 1] :
@@ -1464,64 +1584,51 @@ static int estimate_best_b_count(MpegEncContext *s)
                                        s->tmp_frames[i]->linesize[0],
                                        data[0],
                                        pre_input.f->linesize[0],
-                                       c->width, c->height);
+                                       s->tmp_frames[i]->width,
+                                       s->tmp_frames[i]->height);
             s->mpvencdsp.shrink[scale](s->tmp_frames[i]->data[1],
                                        s->tmp_frames[i]->linesize[1],
                                        data[1],
                                        pre_input.f->linesize[1],
-                                       c->width >> 1, c->height >> 1);
+                                       s->tmp_frames[i]->width  >> 1,
+                                       s->tmp_frames[i]->height >> 1);
             s->mpvencdsp.shrink[scale](s->tmp_frames[i]->data[2],
                                        s->tmp_frames[i]->linesize[2],
                                        data[2],
                                        pre_input.f->linesize[2],
-                                       c->width >> 1, c->height >> 1);
+                                       s->tmp_frames[i]->width  >> 1,
+                                       s->tmp_frames[i]->height >> 1);
         }
     }
+    emms_c();
 
-    for (j = 0; j < s->max_b_frames + 1; j++) {
-        int64_t rd = 0;
-
-        if (!s->input_picture[j])
+    for (e.nb_cands = 0; e.nb_cands < s->max_b_frames + 1; e.nb_cands++)
+        if (!s->input_picture[e.nb_cands])
             break;
+    e.nb_jobs = 1;
+    if (s->avctx->active_thread_type & FF_THREAD_SLICE)
+        e.nb_jobs = av_clip(s->avctx->thread_count, 1, e.nb_cands);
 
-        c->error[0] = c->error[1] = c->error[2] = 0;
-
-        s->tmp_frames[0]->pict_type = AV_PICTURE_TYPE_I;
-        s->tmp_frames[0]->quality   = 1 * FF_QP2LAMBDA;
-
-        out_size = encode_frame(c, s->tmp_frames[0]);
-
-        //rd += (out_size * lambda2) >> FF_LAMBDA_SHIFT;
-
-        for (i = 0; i < s->max_b_frames + 1; i++) {
-            int is_p = i % (j + 1) == j || i == s->max_b_frames;
+    s->avctx->execute2(s->avctx, estimate_b_count_thread, &e, rets, e.nb_jobs);
 
-            s->tmp_frames[i + 1]->pict_type = is_p ?
-                                     AV_PICTURE_TYPE_P : AV_PICTURE_TYPE_B;
-            s->tmp_frames[i + 1]->quality   = is_p ? p_lambda : b_lambda;
-
-            out_size = encode_frame(c, s->tmp_frames[i + 1]);
-
-            rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
+    for (j = 0; j < e.nb_jobs; j++) {
+        if (rets[j] < 0) {
+            ret = rets[j];
+            goto fail;
         }
+    }
 
-        /* get the delayed frames */
-        while (out_size) {
-            out_size = encode_frame(c, NULL);
-            rd += (out_size * lambda2) >> (FF_LAMBDA_SHIFT - 3);
-        }
-
-        rd += c->error[0] + c->error[1] + c->error[2];
-
-        if (rd < best_rd) {
-            best_rd = rd;
+    for (j = 0; j < e.nb_cands; j++) {
+        if (e.rd[j] < best_rd) {
+            best_rd = e.rd[j];
             best_b_count = j;
         }
     }
-
-    avcodec_free_context(&c);
-
-    return best_b_count;
+    ret = best_b_count;
+fail:
+    for (i = 0; i < e.nb_jobs; i++)
+        avcodec_free_context(&e.ctx[i]);
+    return ret;
 }
 
 static int select_input_picture(MpegEncContext *s)
@@ -1602,6 +1709,8 @@ static int select_input_picture(MpegEncContext *s)
                 }
             } else if (s->b_frame_strategy == 2) {
                 b_frames = estimate_best_b_count(s);
+                if (b_frames < 0)
+                    return b_frames;
             }
 
             emms_c();
@@ -37,8 +37,6 @@
 #include <libv4l2.h>
 #endif
 
-static const int desired_video_buffers = 256;
-
 #define V4L_ALLFORMATS  3
 #define V4L_RAWFORMATS  1
 #define V4L_COMPFORMATS 2
@@ -81,6 +79,11 @@ struct video_data {
     volatile int buffers_queued;
     void **buf_start;
     unsigned int *buf_len;
+    int memory;          /**< V4L2_MEMORY_*, set by a private option. */
+    int desired_buffers; /**< Set by a private option. */
+    AVBufferPool *pool;  /**< Buffers handed to the driver in USERPTR mode */
+    AVBufferRef **buf_ref;
+    unsigned int buf_size;
     char *standard;
     v4l2_std_id std_id;
     int channel;
@@ -334,7 +337,7 @@ static int mmap_init(AVFormatContext *ctx)
     struct video_data *s = ctx->priv_data;
     struct v4l2_requestbuffers req = {
         .type   = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-        .count  = desired_video_buffers,
+        .count  = s->desired_buffers,
         .memory = V4L2_MEMORY_MMAP
     };
 
@@ -394,6 +397,59 @@ static int mmap_init(AVFormatContext *ctx)
     return 0;
 }
 
+static int userptr_init(AVFormatContext *ctx)
+{
+    struct video_data *s = ctx->priv_data;
+    struct v4l2_format fmt = { .type = V4L2_BUF_TYPE_VIDEO_CAPTURE };
+    struct v4l2_requestbuffers req = {
+        .type   = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+        .count  = s->desired_buffers,
+        .memory = V4L2_MEMORY_USERPTR
+    };
+    int res;
+
+    if (v4l2_ioctl(s->fd, VIDIOC_G_FMT, &fmt) < 0) {
+        res = AVERROR(errno);
+        av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_G_FMT): %s\n", av_err2str(res));
+        return res;
+    }
+    /* frame_size is an error code for compressed formats */
+    s->buf_size = fmt.fmt.pix.sizeimage;
+    if (s->frame_size > 0)
+        s->buf_size = FFMAX(s->buf_size, s->frame_size);
+    if (!s->buf_size || s->buf_size > INT_MAX - AV_INPUT_BUFFER_PADDING_SIZE) {
+        av_log(ctx, AV_LOG_ERROR, "Invalid buffer size %u\n", s->buf_size);
+        return AVERROR(EINVAL);
+    }
+
+    if (v4l2_ioctl(s->fd, VIDIOC_REQBUFS, &req) < 0) {
+        res = AVERROR(errno);
+        av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_REQBUFS): %s\n", av_err2str(res));
+        if (res == AVERROR(EINVAL))
+            av_log(ctx, AV_LOG_ERROR, "The device does not support user pointer I/O, "
+                   "use -io_method mmap\n");
+        return res;
+    }
+
+    if (req.count < 2) {
+        av_log(ctx, AV_LOG_ERROR, "Insufficient buffer memory\n");
+        return AVERROR(ENOMEM);
+    }
+    s->buffers = req.count;
+    s->buf_ref = av_mallocz_array(s->buffers, sizeof(*s->buf_ref));
+    if (!s->buf_ref)
+        return AVERROR(ENOMEM);
+
+    /* the padding lets the buffers be returned as packets as they are */
+    s->pool = av_buffer_pool_init(s->buf_size + AV_INPUT_BUFFER_PADDING_SIZE, NULL);
+    if (!s->pool) {
+        av_freep(&s->buf_ref);
+        return AVERROR(ENOMEM);
+    }
+
+    return 0;
+}
+
 static int enqueue_buffer(struct video_data *s, struct v4l2_buffer *buf)
 {
     int res = 0;
@@ -408,6 +464,31 @@ static int enqueue_buffer(struct video_data *s, struct v4l2_buffer *buf)
     return res;
 }
 
+/**
+ * Queue a fresh buffer from the pool at the given index. Captured buffers
+ * are handed out as packets and replaced, so the driver never runs dry.
+ */
+static int userptr_enqueue_buffer(struct video_data *s, int index)
+{
+    struct v4l2_buffer buf = {
+        .type   = V4L2_BUF_TYPE_VIDEO_CAPTURE,
+        .index  = index,
+        .memory = V4L2_MEMORY_USERPTR
+    };
+    int res;
+
+    s->buf_ref[index] = av_buffer_pool_get(s->pool);
+    if (!s->buf_ref[index])
+        return AVERROR(ENOMEM);
+
+    buf.m.userptr = (unsigned long)s->buf_ref[index]->data;
+    buf.length    = s->buf_size;
+    if ((res = enqueue_buffer(s, &buf)) < 0)
+        av_buffer_unref(&s->buf_ref[index]);
+
+    return res;
+}
+
 static void mmap_release_buffer(void *opaque, uint8_t *data)
 {
     struct v4l2_buffer buf = { 0 };
@@ -488,7 +569,7 @@ static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
     struct video_data *s = ctx->priv_data;
     struct v4l2_buffer buf = {
         .type   = V4L2_BUF_TYPE_VIDEO_CAPTURE,
-        .memory = V4L2_MEMORY_MMAP
+        .memory = s->memory
     };
     int res;
 
@@ -537,8 +618,21 @@ static int mmap_read_frame(AVFormatContext *ctx, AVPacket *pkt)
         }
     }
 
-    /* Image is at s->buff_start[buf.index] */
-    if (avpriv_atomic_int_get(&s->buffers_queued) == FFMAX(s->buffers / 8, 1)) {
+    if (s->memory == V4L2_MEMORY_USERPTR) {
+        /* hand the captured buffer out and queue a new one in its place */
+        pkt->buf  = s->buf_ref[buf.index];
+        pkt->data = pkt->buf->data;
+        pkt->size = buf.bytesused;
+        s->buf_ref[buf.index] = NULL;
+        memset(pkt->data + pkt->size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+        res = userptr_enqueue_buffer(s, buf.index);
+        if (res < 0) {
+            av_packet_unref(pkt);
+            return res;
+        }
+    } else if (avpriv_atomic_int_get(&s->buffers_queued) == FFMAX(s->buffers / 8, 1)) {
+        /* Image is at s->buff_start[buf.index] */
         /* when we start getting low on queued buffers, fall back on copying data */
         res = av_new_packet(pkt, buf.bytesused);
         if (res < 0) {
@@ -600,6 +694,12 @@ static int mmap_start(AVFormatContext *ctx)
             .memory = V4L2_MEMORY_MMAP
         };
 
+        if (s->memory == V4L2_MEMORY_USERPTR) {
+            if ((res = userptr_enqueue_buffer(s, i)) < 0)
+                return res;
+            continue;
+        }
+
         if (v4l2_ioctl(s->fd, VIDIOC_QBUF, &buf) < 0) {
             res = AVERROR(errno);
             av_log(ctx, AV_LOG_ERROR, "ioctl(VIDIOC_QBUF): %s\n",
@@ -630,6 +730,14 @@ static void mmap_close(struct video_data *s)
      * not do anything about it anyway...
      */
     v4l2_ioctl(s->fd, VIDIOC_STREAMOFF, &type);
+    if (s->memory == V4L2_MEMORY_USERPTR) {
+        /* buffers still owned by packets are freed with them */
+        for (i = 0; i < s->buffers; i++)
+            av_buffer_unref(&s->buf_ref[i]);
+        av_freep(&s->buf_ref);
+        av_buffer_pool_uninit(&s->pool);
+        return;
+    }
     for (i = 0; i < s->buffers; i++) {
         v4l2_munmap(s->buf_start[i], s->buf_len[i]);
     }
@@ -939,7 +1047,14 @@ static int v4l2_read_header(AVFormatContext *ctx)
     s->frame_size = av_image_get_buffer_size(st->codecpar->format,
                                              s->width, s->height, 1);
 
-    if ((res = mmap_init(ctx)) ||
+    if (s->memory == V4L2_MEMORY_USERPTR && s->use_libv4l2) {
+        av_log(ctx, AV_LOG_ERROR, "User pointer I/O cannot be used with libv4l2\n");
+        res = AVERROR(EINVAL);
+        goto fail;
+    }
+
+    if ((res = s->memory == V4L2_MEMORY_USERPTR ? userptr_init(ctx)
+                                                : mmap_init(ctx)) ||
         (res = mmap_start(ctx)) < 0)
             goto fail;
 
@@ -1110,6 +1225,11 @@ static const AVOption options[] = {
     { "abs",          "use absolute timestamps (wall clock)",                     OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_ABS      }, 0, 2, DEC, "timestamps" },
     { "mono2abs",     "force conversion from monotonic to absolute timestamps",   OFFSET(ts_mode),      AV_OPT_TYPE_CONST,  {.i64 = V4L_TS_MONO2ABS }, 0, 2, DEC, "timestamps" },
     { "use_libv4l2",  "use libv4l2 (v4l-utils) conversion functions",             OFFSET(use_libv4l2),  AV_OPT_TYPE_BOOL,   {.i64 = 0}, 0, 1, DEC },
+
+    { "io_method",    "set the buffer I/O method",                                OFFSET(memory),       AV_OPT_TYPE_INT,    {.i64 = V4L2_MEMORY_MMAP }, V4L2_MEMORY_MMAP, V4L2_MEMORY_USERPTR, DEC, "io_method" },
+    { "mmap",         "capture into memory mapped device buffers",                0,                    AV_OPT_TYPE_CONST,  {.i64 = V4L2_MEMORY_MMAP    }, 0, 0, DEC, "io_method" },
+    { "userptr",      "capture into buffers from a pool, never copying",          0,                    AV_OPT_TYPE_CONST,  {.i64 = V4L2_MEMORY_USERPTR }, 0, 0, DEC, "io_method" },
+    { "buffers",      "set the number of buffers requested from the driver",      OFFSET(desired_buffers), AV_OPT_TYPE_INT, {.i64 = 256 }, 2, INT_MAX, DEC },
     { NULL },
 };
 
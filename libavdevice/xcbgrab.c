@@ -37,6 +37,11 @@
 #include <xcb/shape.h>
 #endif
 
+#if CONFIG_LIBXCB_DAMAGE
+#include <xcb/damage.h>
+#endif
+
+#include "libavutil/buffer.h"
 #include "libavutil/internal.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
@@ -54,6 +59,14 @@ typedef struct XCBGrabContext {
     xcb_window_t window;
 #if CONFIG_LIBXCB_SHM
     xcb_shm_seg_t segment;
+#endif
+#if CONFIG_LIBXCB_DAMAGE
+    xcb_damage_damage_t damage;
+    uint8_t damage_event;
+    AVBufferRef *frame_buf;
+    int frame_x, frame_y;
+    xcb_rectangle_t cursor_rect;
+    uint32_t cursor_serial;
 #endif
     int64_t time_frame;
     AVRational time_base;
@@ -68,6 +81,8 @@ typedef struct XCBGrabContext {
     int show_region;
     int region_border;
     int centered;
+    int use_damage;
+    int skip_unchanged;
 
     const char *video_size;
     const char *framerate;
@@ -92,6 +107,8 @@ static const AVOption options[] = {
     { "centered", "Keep the mouse pointer at the center of grabbing region when following.", 0, AV_OPT_TYPE_CONST, { .i64 = -1 }, INT_MIN, INT_MAX, D, "follow_mouse" },
     { "show_region", "Show the grabbing region.", OFFSET(show_region), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, D },
     { "region_border", "Set the region border thickness.", OFFSET(region_border), AV_OPT_TYPE_INT, { .i64 = 3 }, 1, 128, D },
+    { "damage", "Only grab the screen areas reported as changed by XDamage.", OFFSET(use_damage), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
+    { "skip_unchanged", "Do not output frames identical to the previous one.", OFFSET(skip_unchanged), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
     { NULL },
 };
 
@@ -310,22 +327,14 @@ static int check_xfixes(xcb_connection_t *conn)
     (target) + ((source) * (255 - (alpha)) + 255 / 2) / 255
 
 static void xcbgrab_draw_mouse(AVFormatContext *s, AVPacket *pkt,
-                               xcb_query_pointer_reply_t *p,
-                               xcb_get_geometry_reply_t *geo)
+                               xcb_xfixes_get_cursor_image_reply_t *ci)
 {
     XCBGrabContext *gr = s->priv_data;
     uint32_t *cursor;
     uint8_t *image = pkt->data;
     int stride     = gr->bpp / 8;
-    xcb_xfixes_get_cursor_image_cookie_t cc;
-    xcb_xfixes_get_cursor_image_reply_t *ci;
     int cx, cy, x, y, w, h, c_off, i_off;
 
-    cc = xcb_xfixes_get_cursor_image(gr->conn);
-    ci = xcb_xfixes_get_cursor_image_reply(gr->conn, cc, NULL);
-    if (!ci)
-        return;
-
     cursor = xcb_xfixes_get_cursor_image_cursor_image(ci);
     if (!cursor)
         return;
@@ -373,11 +382,213 @@ static void xcbgrab_draw_mouse(AVFormatContext *s, AVPacket *pkt,
         cursor +=  ci->width - w - c_off;
         image  += (gr->width - w - i_off) * stride;
     }
-
-    free(ci);
 }
 #endif /* CONFIG_LIBXCB_XFIXES */
 
+#if CONFIG_LIBXCB_DAMAGE
+#define MAX_DAMAGE_RECTS 64
+
+static int check_damage(XCBGrabContext *c)
+{
+    const xcb_query_extension_reply_t *ext;
+    xcb_damage_query_version_cookie_t cookie;
+    xcb_damage_query_version_reply_t *reply;
+
+    ext = xcb_get_extension_data(c->conn, &xcb_damage_id);
+    if (!ext || !ext->present)
+        return 0;
+
+    cookie = xcb_damage_query_version(c->conn, XCB_DAMAGE_MAJOR_VERSION,
+                                      XCB_DAMAGE_MINOR_VERSION);
+    reply  = xcb_damage_query_version_reply(c->conn, cookie, NULL);
+    if (!reply)
+        return 0;
+    free(reply);
+
+    c->damage_event = ext->first_event + XCB_DAMAGE_NOTIFY;
+    c->damage       = xcb_generate_id(c->conn);
+    xcb_damage_create(c->conn, c->damage, c->screen->root,
+                      XCB_DAMAGE_REPORT_LEVEL_DELTA_RECTANGLES);
+
+    return 1;
+}
+
+/**
+ * Clip a rectangle in root window coordinates to the grabbed area and
+ * append it to rects.
+ *
+ * @return 0 if there is no room left, 1 otherwise
+ */
+static int add_damage_rect(XCBGrabContext *c, xcb_rectangle_t *rects,
+                           int *nb_rects, const xcb_rectangle_t *r)
+{
+    int x0 = FFMAX(r->x, c->x), x1 = FFMIN(r->x + r->width,  c->x + c->width);
+    int y0 = FFMAX(r->y, c->y), y1 = FFMIN(r->y + r->height, c->y + c->height);
+
+    if (x0 >= x1 || y0 >= y1)
+        return 1;
+    if (*nb_rects == MAX_DAMAGE_RECTS)
+        return 0;
+
+    rects[*nb_rects].x      = x0;
+    rects[*nb_rects].y      = y0;
+    rects[*nb_rects].width  = x1 - x0;
+    rects[*nb_rects].height = y1 - y0;
+    (*nb_rects)++;
+
+    return 1;
+}
+
+/**
+ * Gather the areas damaged since the previous call.
+ *
+ * @return the number of rectangles, or -1 if the whole area must be grabbed
+ */
+static int xcbgrab_collect_damage(XCBGrabContext *c, xcb_rectangle_t *rects)
+{
+    xcb_generic_event_t *ev;
+    int nb_rects = 0, full = 0;
+
+    /* Empty the damage region, so that new damage is reported again, and
+     * make sure every event sent before the subtraction has been queued. */
+    xcb_damage_subtract(c->conn, c->damage, XCB_NONE, XCB_NONE);
+    free(xcb_get_input_focus_reply(c->conn, xcb_get_input_focus(c->conn),
+                                   NULL));
+
+    while ((ev = xcb_poll_for_event(c->conn))) {
+        if ((ev->response_type & 0x7f) == c->damage_event) {
+            xcb_damage_notify_event_t *dev = (xcb_damage_notify_event_t *)ev;
+            if (!full && !add_damage_rect(c, rects, &nb_rects, &dev->area))
+                full = 1;
+        }
+        free(ev);
+    }
+
+    return full ? -1 : nb_rects;
+}
+
+/**
+ * Update the persistent frame with the damaged areas only.
+ *
+ * @param cursor        area covered by the mouse pointer drawn on this frame
+ * @param cursor_serial serial of the pointer image drawn on this frame
+ * @return 1 if the frame did not change since the previous one, 0 if it
+ *         was updated and the mouse pointer must be drawn again, a negative
+ *         error code otherwise
+ */
+static int xcbgrab_frame_damage(AVFormatContext *s, AVPacket *pkt,
+                                const xcb_rectangle_t *cursor,
+                                uint32_t cursor_serial)
+{
+    XCBGrabContext *c = s->priv_data;
+    xcb_rectangle_t rects[MAX_DAMAGE_RECTS];
+    xcb_get_image_cookie_t iq[MAX_DAMAGE_RECTS];
+    int bpp      = c->bpp / 8;
+    int linesize = c->width * bpp;
+    int i, y, nb_rects, ret = 0;
+
+    nb_rects = xcbgrab_collect_damage(c, rects);
+
+    if (!c->frame_buf || c->x != c->frame_x || c->y != c->frame_y)
+        nb_rects = -1;
+
+    if (!nb_rects && cursor->x == c->cursor_rect.x &&
+        cursor->y == c->cursor_rect.y &&
+        cursor->width  == c->cursor_rect.width  &&
+        cursor->height == c->cursor_rect.height &&
+        cursor_serial  == c->cursor_serial) {
+        if (c->skip_unchanged)
+            return AVERROR(EAGAIN);
+        ret = 1;
+        goto output;
+    }
+
+    /* grab the area under the previous pointer again to erase it */
+    if (nb_rects >= 0 &&
+        !add_damage_rect(c, rects, &nb_rects, &c->cursor_rect))
+        nb_rects = -1;
+
+    if (nb_rects < 0) {
+        rects[0].x      = c->x;
+        rects[0].y      = c->y;
+        rects[0].width  = c->width;
+        rects[0].height = c->height;
+        nb_rects        = 1;
+    }
+
+    if (!c->frame_buf) {
+        int size = c->frame_size + AV_INPUT_BUFFER_PADDING_SIZE;
+        c->frame_buf = av_buffer_allocz(size);
+        if (!c->frame_buf)
+            return AVERROR(ENOMEM);
+    } else if ((ret = av_buffer_make_writable(&c->frame_buf)) < 0) {
+        return ret;
+    }
+
+    for (i = 0; i < nb_rects; i++)
+        iq[i] = xcb_get_image(c->conn, XCB_IMAGE_FORMAT_Z_PIXMAP,
+                              c->screen->root, rects[i].x, rects[i].y,
+                              rects[i].width, rects[i].height, ~0);
+
+    for (i = 0; i < nb_rects; i++) {
+        xcb_generic_error_t *e = NULL;
+        xcb_get_image_reply_t *img = xcb_get_image_reply(c->conn, iq[i], &e);
+        const uint8_t *src;
+        uint8_t *dst;
+        int w = rects[i].width * bpp, src_linesize;
+
+        if (e || !img) {
+            if (e)
+                av_log(s, AV_LOG_ERROR,
+                       "Cannot get the image data "
+                       "event_error: response_type:%u error_code:%u "
+                       "sequence:%u resource_id:%u minor_code:%u major_code:%u.\n",
+                       e->response_type, e->error_code,
+                       e->sequence, e->resource_id, e->minor_code, e->major_code);
+            ret = e ? AVERROR(EACCES) : AVERROR(EAGAIN);
+            free(e);
+            free(img);
+            continue;
+        }
+
+        src          = xcb_get_image_data(img);
+        src_linesize = xcb_get_image_data_length(img) / rects[i].height;
+        dst          = c->frame_buf->data + (rects[i].y - c->y) * linesize +
+                                            (rects[i].x - c->x) * bpp;
+
+        if (src_linesize < w) {
+            ret = AVERROR_INVALIDDATA;
+        } else {
+            for (y = 0; y < rects[i].height; y++)
+                memcpy(dst + y * linesize, src + y * src_linesize, w);
+        }
+
+        free(img);
+    }
+
+    if (ret < 0) {
+        /* the frame is only partially updated, start over next time */
+        av_buffer_unref(&c->frame_buf);
+        return ret;
+    }
+
+    c->frame_x       = c->x;
+    c->frame_y       = c->y;
+    c->cursor_rect   = *cursor;
+    c->cursor_serial = cursor_serial;
+
+output:
+    pkt->buf = av_buffer_ref(c->frame_buf);
+    if (!pkt->buf)
+        return AVERROR(ENOMEM);
+
+    pkt->data = pkt->buf->data;
+    pkt->size = c->frame_size;
+
+    return ret;
+}
+#endif /* CONFIG_LIBXCB_DAMAGE */
+
 static void xcbgrab_update_region(AVFormatContext *s)
 {
     XCBGrabContext *c     = s->priv_data;
@@ -397,6 +608,9 @@ static int xcbgrab_read_packet(AVFormatContext *s, AVPacket *pkt)
     xcb_get_geometry_cookie_t gc;
     xcb_query_pointer_reply_t *p  = NULL;
     xcb_get_geometry_reply_t *geo = NULL;
+#if CONFIG_LIBXCB_XFIXES
+    xcb_xfixes_get_cursor_image_reply_t *ci = NULL;
+#endif
     int ret = 0;
 
     wait_frame(s, pkt);
@@ -414,28 +628,64 @@ static int xcbgrab_read_packet(AVFormatContext *s, AVPacket *pkt)
     if (c->show_region)
         xcbgrab_update_region(s);
 
+#if CONFIG_LIBXCB_XFIXES
+    if (c->draw_mouse && p->same_screen) {
+        xcb_xfixes_get_cursor_image_cookie_t cc;
+
+        cc = xcb_xfixes_get_cursor_image(c->conn);
+        ci = xcb_xfixes_get_cursor_image_reply(c->conn, cc, NULL);
+    }
+#endif
+
+#if CONFIG_LIBXCB_DAMAGE
+    if (c->use_damage) {
+        xcb_rectangle_t cursor = { 0 };
+        uint32_t cursor_serial = 0;
+
+#if CONFIG_LIBXCB_XFIXES
+        if (ci) {
+            cursor.x      = ci->x - ci->xhot;
+            cursor.y      = ci->y - ci->yhot;
+            cursor.width  = ci->width;
+            cursor.height = ci->height;
+            cursor_serial = ci->cursor_serial;
+        }
+#endif
+        ret = xcbgrab_frame_damage(s, pkt, &cursor, cursor_serial);
+    } else
+#endif
+    {
 #if CONFIG_LIBXCB_SHM
-    if (c->has_shm && xcbgrab_frame_shm(s, pkt) < 0)
-        c->has_shm = 0;
+        if (c->has_shm && xcbgrab_frame_shm(s, pkt) < 0)
+            c->has_shm = 0;
 #endif
-    if (!c->has_shm)
-        ret = xcbgrab_frame(s, pkt);
+        if (!c->has_shm)
+            ret = xcbgrab_frame(s, pkt);
+    }
 
 #if CONFIG_LIBXCB_XFIXES
-    if (ret >= 0 && c->draw_mouse && p->same_screen)
-        xcbgrab_draw_mouse(s, pkt, p, geo);
+    /* an unchanged damage-tracked frame already carries the pointer */
+    if (!ret && ci)
+        xcbgrab_draw_mouse(s, pkt, ci);
+    free(ci);
 #endif
 
     free(p);
     free(geo);
 
-    return ret;
+    return FFMIN(ret, 0);
 }
 
 static av_cold int xcbgrab_read_close(AVFormatContext *s)
 {
     XCBGrabContext *ctx = s->priv_data;
 
+#if CONFIG_LIBXCB_DAMAGE
+    if (ctx->damage)
+        xcb_damage_destroy(ctx->conn, ctx->damage);
+    av_buffer_unref(&ctx->frame_buf);
+#endif
+
     xcb_disconnect(ctx->conn);
 
     return 0;
@@ -665,6 +915,18 @@ static av_cold int xcbgrab_read_header(AVFormatContext *s)
         c->segment = xcb_generate_id(c->conn);
 #endif
 
+#if CONFIG_LIBXCB_DAMAGE
+    if (c->use_damage && !(c->use_damage = check_damage(c)))
+        av_log(s, AV_LOG_WARNING,
+               "XDamage not available, grabbing the whole area.\n");
+#else
+    if (c->use_damage) {
+        av_log(s, AV_LOG_WARNING,
+               "XDamage support not compiled in, grabbing the whole area.\n");
+        c->use_damage = 0;
+    }
+#endif
+
 #if CONFIG_LIBXCB_XFIXES
     if (c->draw_mouse) {
         if (!(c->draw_mouse = check_xfixes(c->conn))) {
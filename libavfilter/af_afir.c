@@ -0,0 +1,395 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * An arbitrary audio FIR filter, the impulse response is read from the
+ * second input
+ */
+
+#include "libavutil/audio_fifo.h"
+#include "libavutil/common.h"
+#include "libavutil/opt.h"
+
+#include "audio.h"
+#include "avfilter.h"
+#include "formats.h"
+#include "internal.h"
+#include "partconv.h"
+
+typedef struct AudioFIRContext {
+    const AVClass *class;
+
+    float dry_gain;
+    float wet_gain;
+    float length;
+    int again;
+    float max_ir_len;
+    int minp;
+    int maxp;
+
+    int one2many;
+    int nb_channels;
+    int nb_taps;
+    int have_coeffs;
+    int eof_coeffs;
+    int64_t pts;
+
+    AVAudioFifo *fifo[2];
+    PartConvContext *conv;      /**< convolution engine for each channel */
+} AudioFIRContext;
+
+typedef struct ThreadData {
+    AVFrame *in, *out;
+} ThreadData;
+
+static int fir_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    AudioFIRContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *in = td->in, *out = td->out;
+    const int start = (in->channels * jobnr) / nb_jobs;
+    const int end   = (in->channels * (jobnr + 1)) / nb_jobs;
+    int ch, n, i;
+
+    for (ch = start; ch < end; ch++) {
+        const float *src = (const float *)in->extended_data[ch];
+        float *dst = (float *)out->extended_data[ch];
+
+        for (n = 0; n < in->nb_samples; n += s->minp)
+            ff_partconv_process(&s->conv[ch], dst + n, src + n);
+
+        if (s->dry_gain) {
+            for (i = 0; i < in->nb_samples; i++)
+                dst[i] += src[i] * s->dry_gain;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Filter nb_samples from the main input FIFO, padding them with silence to
+ * a whole number of blocks.
+ */
+static int fir_frame(AVFilterContext *ctx, int nb_samples)
+{
+    AudioFIRContext *s = ctx->priv;
+    AVFilterLink *outlink = ctx->outputs[0];
+    int size = FFALIGN(nb_samples, s->minp);
+    ThreadData td;
+    AVFrame *in, *out;
+
+    in = ff_get_audio_buffer(outlink, size);
+    if (!in)
+        return AVERROR(ENOMEM);
+    av_audio_fifo_read(s->fifo[0], (void **)in->extended_data, nb_samples);
+    av_samples_set_silence(in->extended_data, nb_samples, size - nb_samples,
+                           in->channels, in->format);
+
+    out = ff_get_audio_buffer(outlink, size);
+    if (!out) {
+        av_frame_free(&in);
+        return AVERROR(ENOMEM);
+    }
+
+    td.in  = in;
+    td.out = out;
+    ctx->internal->execute(ctx, fir_channels, &td, NULL,
+                           FFMIN(outlink->channels, ff_filter_get_nb_threads(ctx)));
+
+    av_frame_free(&in);
+    out->nb_samples = nb_samples;
+    out->pts = s->pts;
+    if (s->pts != AV_NOPTS_VALUE)
+        s->pts += nb_samples;
+
+    return ff_filter_frame(outlink, out);
+}
+
+static int convert_coeffs(AVFilterContext *ctx)
+{
+    AudioFIRContext *s = ctx->priv;
+    AVFilterLink *irlink = ctx->inputs[1];
+    AVFrame *ir;
+    float gain = s->wet_gain;
+    int ch, i, ret = 0;
+
+    s->nb_taps = av_audio_fifo_size(s->fifo[1]) * s->length;
+    if (s->nb_taps <= 0) {
+        av_log(ctx, AV_LOG_ERROR, "Empty impulse response.\n");
+        return AVERROR(EINVAL);
+    }
+
+    ir = ff_get_audio_buffer(irlink, s->nb_taps);
+    if (!ir)
+        return AVERROR(ENOMEM);
+    av_audio_fifo_read(s->fifo[1], (void **)ir->extended_data, s->nb_taps);
+
+    if (s->again) {
+        float power = 0;
+
+        for (ch = 0; ch < irlink->channels; ch++) {
+            const float *coeffs = (const float *)ir->extended_data[ch];
+            float sum = 0;
+
+            for (i = 0; i < s->nb_taps; i++)
+                sum += coeffs[i] * coeffs[i];
+            power = FFMAX(power, sum);
+        }
+        if (power > 0)
+            gain /= sqrtf(power);
+    }
+
+    for (ch = 0; ch < irlink->channels; ch++) {
+        float *coeffs = (float *)ir->extended_data[ch];
+
+        for (i = 0; i < s->nb_taps; i++)
+            coeffs[i] *= gain;
+    }
+
+    for (ch = 0; ch < s->nb_channels; ch++) {
+        const float *coeffs = (const float *)ir->extended_data[s->one2many ? 0 : ch];
+
+        ret = ff_partconv_init(&s->conv[ch], coeffs, s->nb_taps, s->minp, s->maxp);
+        if (ret < 0)
+            break;
+    }
+
+    av_frame_free(&ir);
+    av_log(ctx, AV_LOG_DEBUG, "nb_taps: %d\n", s->nb_taps);
+    if (ret >= 0)
+        s->have_coeffs = 1;
+
+    return ret;
+}
+
+static int filter_frame(AVFilterLink *link, AVFrame *frame)
+{
+    AVFilterContext *ctx = link->dst;
+    AudioFIRContext *s = ctx->priv;
+    int ret, nb_samples;
+
+    if (link == ctx->inputs[1]) {
+        /* an IR over the limit is reported by request_frame() */
+        ret = 0;
+        if (av_audio_fifo_size(s->fifo[1]) <= s->max_ir_len * link->sample_rate)
+            ret = av_audio_fifo_write(s->fifo[1], (void **)frame->extended_data,
+                                      frame->nb_samples);
+        av_frame_free(&frame);
+        return FFMIN(ret, 0);
+    }
+
+    if (s->pts == AV_NOPTS_VALUE && frame->pts != AV_NOPTS_VALUE)
+        s->pts = av_rescale_q(frame->pts, link->time_base, ctx->outputs[0]->time_base) -
+                 av_audio_fifo_size(s->fifo[0]);
+
+    ret = av_audio_fifo_write(s->fifo[0], (void **)frame->extended_data,
+                              frame->nb_samples);
+    av_frame_free(&frame);
+    if (ret < 0)
+        return ret;
+
+    /* main input samples are queued until the IR is complete */
+    nb_samples = av_audio_fifo_size(s->fifo[0]) / s->minp * s->minp;
+    if (!s->have_coeffs || !nb_samples)
+        return 0;
+
+    return fir_frame(ctx, nb_samples);
+}
+
+static int request_frame(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AudioFIRContext *s = ctx->priv;
+    int ret, nb_samples;
+
+    if (!s->eof_coeffs) {
+        if (av_audio_fifo_size(s->fifo[1]) > s->max_ir_len * ctx->inputs[1]->sample_rate) {
+            av_log(ctx, AV_LOG_ERROR, "Impulse response longer than %g seconds.\n",
+                   s->max_ir_len);
+            return AVERROR(EINVAL);
+        }
+        ret = ff_request_frame(ctx->inputs[1]);
+        if (ret == AVERROR_EOF) {
+            s->eof_coeffs = 1;
+            ret = 0;
+        }
+        return ret;
+    }
+
+    if (!s->have_coeffs) {
+        ret = convert_coeffs(ctx);
+        if (ret < 0)
+            return ret;
+
+        nb_samples = av_audio_fifo_size(s->fifo[0]) / s->minp * s->minp;
+        if (nb_samples)
+            return fir_frame(ctx, nb_samples);
+    }
+
+    ret = ff_request_frame(ctx->inputs[0]);
+    if (ret == AVERROR_EOF && av_audio_fifo_size(s->fifo[0]) > 0)
+        return fir_frame(ctx, av_audio_fifo_size(s->fifo[0]));
+
+    return ret;
+}
+
+static int query_formats(AVFilterContext *ctx)
+{
+    AVFilterFormats *formats;
+    AVFilterChannelLayouts *layouts;
+    static const enum AVSampleFormat sample_fmts[] = {
+        AV_SAMPLE_FMT_FLTP,
+        AV_SAMPLE_FMT_NONE
+    };
+    int ret;
+
+    layouts = ff_all_channel_counts();
+    if ((ret = ff_channel_layouts_ref(layouts, &ctx->inputs[0]->out_channel_layouts)) < 0 ||
+        (ret = ff_channel_layouts_ref(layouts, &ctx->outputs[0]->in_channel_layouts)) < 0)
+        return ret;
+
+    layouts = ff_all_channel_counts();
+    if ((ret = ff_channel_layouts_ref(layouts, &ctx->inputs[1]->out_channel_layouts)) < 0)
+        return ret;
+
+    formats = ff_make_format_list(sample_fmts);
+    if ((ret = ff_set_common_formats(ctx, formats)) < 0)
+        return ret;
+
+    formats = ff_all_samplerates();
+    return ff_set_common_samplerates(ctx, formats);
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx = outlink->src;
+    AudioFIRContext *s = ctx->priv;
+
+    if (ctx->inputs[0]->channels != ctx->inputs[1]->channels &&
+        ctx->inputs[1]->channels != 1) {
+        av_log(ctx, AV_LOG_ERROR,
+               "Second input must have same number of channels as first input or "
+               "exactly 1 channel.\n");
+        return AVERROR(EINVAL);
+    }
+
+    s->one2many = ctx->inputs[1]->channels == 1;
+    outlink->sample_rate    = ctx->inputs[0]->sample_rate;
+    outlink->time_base      = (AVRational){ 1, outlink->sample_rate };
+    outlink->channel_layout = ctx->inputs[0]->channel_layout;
+    outlink->channels       = ctx->inputs[0]->channels;
+
+    s->fifo[0] = av_audio_fifo_alloc(ctx->inputs[0]->format, ctx->inputs[0]->channels, 1024);
+    s->fifo[1] = av_audio_fifo_alloc(ctx->inputs[1]->format, ctx->inputs[1]->channels, 1024);
+    if (!s->fifo[0] || !s->fifo[1])
+        return AVERROR(ENOMEM);
+
+    s->conv = av_calloc(outlink->channels, sizeof(*s->conv));
+    if (!s->conv)
+        return AVERROR(ENOMEM);
+    s->nb_channels = outlink->channels;
+
+    s->pts = AV_NOPTS_VALUE;
+
+    return 0;
+}
+
+static av_cold int init(AVFilterContext *ctx)
+{
+    AudioFIRContext *s = ctx->priv;
+
+    if (s->minp & (s->minp - 1) || s->maxp & (s->maxp - 1)) {
+        av_log(ctx, AV_LOG_ERROR, "Partition sizes must be powers of 2.\n");
+        return AVERROR(EINVAL);
+    }
+    if (s->minp > s->maxp) {
+        av_log(ctx, AV_LOG_ERROR, "minp must not be larger than maxp.\n");
+        return AVERROR(EINVAL);
+    }
+
+    return 0;
+}
+
+static av_cold void uninit(AVFilterContext *ctx)
+{
+    AudioFIRContext *s = ctx->priv;
+    int ch;
+
+    if (s->conv) {
+        for (ch = 0; ch < s->nb_channels; ch++)
+            ff_partconv_uninit(&s->conv[ch]);
+        av_freep(&s->conv);
+    }
+
+    av_audio_fifo_free(s->fifo[0]);
+    av_audio_fifo_free(s->fifo[1]);
+}
+
+static const AVFilterPad afir_inputs[] = {
+    {
+        .name           = "main",
+        .type           = AVMEDIA_TYPE_AUDIO,
+        .filter_frame   = filter_frame,
+    },{
+        .name           = "ir",
+        .type           = AVMEDIA_TYPE_AUDIO,
+        .filter_frame   = filter_frame,
+    },
+    { NULL }
+};
+
+static const AVFilterPad afir_outputs[] = {
+    {
+        .name          = "default",
+        .type          = AVMEDIA_TYPE_AUDIO,
+        .config_props  = config_output,
+        .request_frame = request_frame,
+    },
+    { NULL }
+};
+
+#define AF AV_OPT_FLAG_AUDIO_PARAM|AV_OPT_FLAG_FILTERING_PARAM
+#define OFFSET(x) offsetof(AudioFIRContext, x)
+
+static const AVOption afir_options[] = {
+    { "dry",    "set dry gain",      OFFSET(dry_gain),   AV_OPT_TYPE_FLOAT, {.dbl=0},    0, 10, AF },
+    { "wet",    "set wet gain",      OFFSET(wet_gain),   AV_OPT_TYPE_FLOAT, {.dbl=1},    0, 10, AF },
+    { "length", "set IR length",     OFFSET(length),     AV_OPT_TYPE_FLOAT, {.dbl=1},    0,  1, AF },
+    { "again",  "enable auto gain",  OFFSET(again),      AV_OPT_TYPE_BOOL,  {.i64=1},    0,  1, AF },
+    { "maxir",  "set max IR length", OFFSET(max_ir_len), AV_OPT_TYPE_FLOAT, {.dbl=30}, 0.1, 60, AF },
+    { "minp",   "set min partition size", OFFSET(minp),  AV_OPT_TYPE_INT,   {.i64=256},  PARTCONV_MIN_SIZE, PARTCONV_MAX_SIZE, AF },
+    { "maxp",   "set max partition size", OFFSET(maxp),  AV_OPT_TYPE_INT,   {.i64=8192}, PARTCONV_MIN_SIZE, PARTCONV_MAX_SIZE, AF },
+    { NULL }
+};
+
+AVFILTER_DEFINE_CLASS(afir);
+
+AVFilter ff_af_afir = {
+    .name          = "afir",
+    .description   = NULL_IF_CONFIG_SMALL("Apply Finite Impulse Response filter with supplied coefficients in 2nd stream."),
+    .priv_size     = sizeof(AudioFIRContext),
+    .priv_class    = &afir_class,
+    .query_formats = query_formats,
+    .init          = init,
+    .uninit        = uninit,
+    .inputs        = afir_inputs,
+    .outputs       = afir_outputs,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
+};
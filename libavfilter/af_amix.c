@@ -51,54 +51,68 @@
 #define DURATION_SHORTEST 1
 #define DURATION_FIRST    2
 
+/**
+ * Number of floats per channel group mixed in one pass. The output is mixed
+ * in blocks of this size so that it stays in cache while all the inputs are
+ * accumulated into it.
+ */
+#define MIX_BLOCK_SIZE 1024
+
 
 typedef struct FrameInfo {
     int nb_samples;
     int64_t pts;
-    struct FrameInfo *next;
 } FrameInfo;
 
 /**
- * Linked list used to store timestamps and frame sizes of all frames in the
+ * Queue used to store timestamps and frame sizes of all frames in the
  * FIFO for the first input.
  *
  * This is needed to keep timestamps synchronized for the case where multiple
  * input frames are pushed to the filter for processing before a frame is
  * requested by the output link.
+ *
+ * The entries are kept in a ring buffer which only grows, so that queueing
+ * and dequeueing frames does not allocate.
  */
 typedef struct FrameList {
     int nb_frames;
     int nb_samples;
-    FrameInfo *list;
-    FrameInfo *end;
+    int first;              /**< index of the oldest entry in frames */
+    int allocated;          /**< number of entries allocated in frames */
+    FrameInfo *frames;
 } FrameList;
 
 static void frame_list_clear(FrameList *frame_list)
 {
     if (frame_list) {
-        while (frame_list->list) {
-            FrameInfo *info = frame_list->list;
-            frame_list->list = info->next;
-            av_free(info);
-        }
         frame_list->nb_frames  = 0;
         frame_list->nb_samples = 0;
-        frame_list->end        = NULL;
+        frame_list->first      = 0;
+    }
+}
+
+static void frame_list_free(FrameList *frame_list)
+{
+    if (frame_list) {
+        frame_list_clear(frame_list);
+        av_freep(&frame_list->frames);
+        frame_list->allocated = 0;
     }
 }
 
 static int frame_list_next_frame_size(FrameList *frame_list)
 {
-    if (!frame_list->list)
+    if (!frame_list->nb_frames)
         return 0;
-    return frame_list->list->nb_samples;
+    return frame_list->frames[frame_list->first].nb_samples;
 }
 
 static int64_t frame_list_next_pts(FrameList *frame_list)
 {
-    if (!frame_list->list)
+    if (!frame_list->nb_frames)
         return AV_NOPTS_VALUE;
-    return frame_list->list->pts;
+    return frame_list->frames[frame_list->first].pts;
 }
 
 static void frame_list_remove_samples(FrameList *frame_list, int nb_samples)
@@ -108,16 +122,14 @@ static void frame_list_remove_samples(FrameList *frame_list, int nb_samples)
     } else {
         int samples = nb_samples;
         while (samples > 0) {
-            FrameInfo *info = frame_list->list;
-            av_assert0(info);
+            FrameInfo *info = &frame_list->frames[frame_list->first];
+            av_assert0(frame_list->nb_frames > 0);
             if (info->nb_samples <= samples) {
                 samples -= info->nb_samples;
-                frame_list->list = info->next;
-                if (!frame_list->list)
-                    frame_list->end = NULL;
-                frame_list->nb_frames--;
                 frame_list->nb_samples -= info->nb_samples;
-                av_free(info);
+                frame_list->nb_frames--;
+                if (++frame_list->first == frame_list->allocated)
+                    frame_list->first = 0;
             } else {
                 info->nb_samples       -= samples;
                 info->pts              += samples;
@@ -130,21 +142,29 @@ static void frame_list_remove_samples(FrameList *frame_list, int nb_samples)
 
 static int frame_list_add_frame(FrameList *frame_list, int nb_samples, int64_t pts)
 {
-    FrameInfo *info = av_malloc(sizeof(*info));
-    if (!info)
-        return AVERROR(ENOMEM);
+    FrameInfo *info;
+    int idx;
+
+    if (frame_list->nb_frames == frame_list->allocated) {
+        int allocated = FFMAX(2 * frame_list->allocated, 16);
+        FrameInfo *frames = av_realloc_array(frame_list->frames, allocated,
+                                             sizeof(*frames));
+        if (!frames)
+            return AVERROR(ENOMEM);
+        /* unwrap the entries stored before the first one */
+        memcpy(frames + frame_list->allocated, frames,
+               frame_list->first * sizeof(*frames));
+        frame_list->frames    = frames;
+        frame_list->allocated = allocated;
+    }
+
+    idx = frame_list->first + frame_list->nb_frames;
+    if (idx >= frame_list->allocated)
+        idx -= frame_list->allocated;
+    info = &frame_list->frames[idx];
     info->nb_samples = nb_samples;
     info->pts        = pts;
-    info->next       = NULL;
 
-    if (!frame_list->list) {
-        frame_list->list = info;
-        frame_list->end  = info;
-    } else {
-        av_assert0(frame_list->end);
-        frame_list->end->next = info;
-        frame_list->end       = info;
-    }
     frame_list->nb_frames++;
     frame_list->nb_samples += nb_samples;
 
@@ -166,10 +186,12 @@ typedef struct MixContext {
     int planar;
     AVAudioFifo **fifos;        /**< audio fifo for each input */
     uint8_t *input_state;       /**< current state of each input */
-    float *input_scale;         /**< mixing scale factor for each input */
+    float input_scale;          /**< mixing scale factor for active inputs */
     float scale_norm;           /**< normalization factor for all inputs */
     int64_t next_pts;           /**< calculated pts for next output frame */
     FrameList *frame_list;      /**< list of frame info for the first input */
+    uint8_t **mix_buf;          /**< samples of one input for the current block */
+    int block_samples;          /**< number of samples mixed in one block */
 } MixContext;
 
 #define OFFSET(x) offsetof(MixContext, x)
@@ -177,7 +199,7 @@ typedef struct MixContext {
 #define F AV_OPT_FLAG_FILTERING_PARAM
 static const AVOption amix_options[] = {
     { "inputs", "Number of inputs.",
-            OFFSET(nb_inputs), AV_OPT_TYPE_INT, { .i64 = 2 }, 1, 32, A|F },
+            OFFSET(nb_inputs), AV_OPT_TYPE_INT, { .i64 = 2 }, 1, INT16_MAX, A|F },
     { "duration", "How to determine the end-of-stream.",
             OFFSET(duration_mode), AV_OPT_TYPE_INT, { .i64 = DURATION_LONGEST }, 0,  2, A|F, "duration" },
         { "longest",  "Duration of longest input.",  0, AV_OPT_TYPE_CONST, { .i64 = DURATION_LONGEST  }, INT_MIN, INT_MAX, A|F, "duration" },
@@ -192,7 +214,7 @@ static const AVOption amix_options[] = {
 AVFILTER_DEFINE_CLASS(amix);
 
 /**
- * Update the scaling factors to apply to each input during mixing.
+ * Update the scaling factor to apply to the active inputs during mixing.
  *
  * This balances the full volume range between active inputs and handles
  * volume transitions when EOF is encountered on an input but mixing continues
@@ -200,26 +222,19 @@ AVFILTER_DEFINE_CLASS(amix);
  */
 static void calculate_scales(MixContext *s, int nb_samples)
 {
-    int i;
-
     if (s->scale_norm > s->active_inputs) {
         s->scale_norm -= nb_samples / (s->dropout_transition * s->sample_rate);
         s->scale_norm = FFMAX(s->scale_norm, s->active_inputs);
     }
 
-    for (i = 0; i < s->nb_inputs; i++) {
-        if (s->input_state[i] & INPUT_ON)
-            s->input_scale[i] = 1.0f / s->scale_norm;
-        else
-            s->input_scale[i] = 0.0f;
-    }
+    s->input_scale = 1.0f / s->scale_norm;
 }
 
 static int config_output(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
     MixContext *s      = ctx->priv;
-    int i;
+    int i, ret;
     char buf[64];
 
     s->planar          = av_sample_fmt_is_planar(outlink->format);
@@ -248,12 +263,15 @@ static int config_output(AVFilterLink *outlink)
     memset(s->input_state, INPUT_ON, s->nb_inputs);
     s->active_inputs = s->nb_inputs;
 
-    s->input_scale = av_mallocz_array(s->nb_inputs, sizeof(*s->input_scale));
-    if (!s->input_scale)
-        return AVERROR(ENOMEM);
     s->scale_norm = s->active_inputs;
     calculate_scales(s, 0);
 
+    s->block_samples = FFALIGN(FFMAX(MIX_BLOCK_SIZE / s->nb_channels, 1), 16);
+    ret = av_samples_alloc_array_and_samples(&s->mix_buf, NULL, s->nb_channels,
+                                             s->block_samples, outlink->format, 0);
+    if (ret < 0)
+        return ret;
+
     av_get_channel_layout_string(buf, sizeof(buf), -1, outlink->channel_layout);
 
     av_log(ctx, AV_LOG_VERBOSE,
@@ -272,8 +290,9 @@ static int output_frame(AVFilterLink *outlink)
 {
     AVFilterContext *ctx = outlink->src;
     MixContext      *s = ctx->priv;
-    AVFrame *out_buf, *in_buf;
-    int nb_samples, ns, ret, i;
+    AVFrame *out_buf;
+    int nb_samples, ns, ret, i, p, offset;
+    int planes, stride;
 
     ret = calc_active_inputs(s);
     if (ret < 0)
@@ -319,31 +338,26 @@ static int output_frame(AVFilterLink *outlink)
     if (!out_buf)
         return AVERROR(ENOMEM);
 
-    in_buf = ff_get_audio_buffer(outlink, nb_samples);
-    if (!in_buf) {
-        av_frame_free(&out_buf);
-        return AVERROR(ENOMEM);
-    }
+    planes = s->planar ? s->nb_channels : 1;
+    stride = s->planar ? 1 : s->nb_channels;
 
-    for (i = 0; i < s->nb_inputs; i++) {
-        if (s->input_state[i] & INPUT_ON) {
-            int planes, plane_size, p;
+    for (offset = 0; offset < nb_samples; offset += s->block_samples) {
+        int len        = FFMIN(s->block_samples, nb_samples - offset);
+        int plane_size = FFALIGN(len * stride, 16);
 
-            av_audio_fifo_read(s->fifos[i], (void **)in_buf->extended_data,
-                               nb_samples);
+        for (i = 0; i < s->nb_inputs; i++) {
+            if (!(s->input_state[i] & INPUT_ON))
+                continue;
 
-            planes     = s->planar ? s->nb_channels : 1;
-            plane_size = nb_samples * (s->planar ? 1 : s->nb_channels);
-            plane_size = FFALIGN(plane_size, 16);
+            av_audio_fifo_read(s->fifos[i], (void **)s->mix_buf, len);
 
             for (p = 0; p < planes; p++) {
-                s->fdsp->vector_fmac_scalar((float *)out_buf->extended_data[p],
-                                           (float *) in_buf->extended_data[p],
-                                           s->input_scale[i], plane_size);
+                s->fdsp->vector_fmac_scalar((float *)out_buf->extended_data[p] + offset * stride,
+                                            (float *)s->mix_buf[p],
+                                            s->input_scale, plane_size);
             }
         }
     }
-    av_frame_free(&in_buf);
 
     out_buf->pts = s->next_pts;
     if (s->next_pts != AV_NOPTS_VALUE)
@@ -352,6 +366,16 @@ static int output_frame(AVFilterLink *outlink)
     return ff_filter_frame(outlink, out_buf);
 }
 
+/**
+ * Mark an input as finished, it is no longer mixed into the output.
+ */
+static void close_input(MixContext *s, int i)
+{
+    if (s->input_state[i] & INPUT_ON)
+        s->active_inputs--;
+    s->input_state[i] = 0;
+}
+
 /**
  * Requests a frame, if needed, from each input link other than the first.
  */
@@ -372,7 +396,7 @@ static int request_samples(AVFilterContext *ctx, int min_samples)
         if (ret == AVERROR_EOF) {
             s->input_state[i] |= INPUT_EOF;
             if (av_audio_fifo_size(s->fifos[i]) == 0) {
-                s->input_state[i] = 0;
+                close_input(s, i);
                 continue;
             }
         } else if (ret < 0)
@@ -382,22 +406,16 @@ static int request_samples(AVFilterContext *ctx, int min_samples)
 }
 
 /**
- * Calculates the number of active inputs and determines EOF based on the
- * duration option.
+ * Determines EOF based on the number of active inputs and the duration
+ * option.
  *
  * @return 0 if mixing should continue, or AVERROR_EOF if mixing should stop.
  */
 static int calc_active_inputs(MixContext *s)
 {
-    int i;
-    int active_inputs = 0;
-    for (i = 0; i < s->nb_inputs; i++)
-        active_inputs += !!(s->input_state[i] & INPUT_ON);
-    s->active_inputs = active_inputs;
-
-    if (!active_inputs ||
+    if (!s->active_inputs ||
         (s->duration_mode == DURATION_FIRST && !(s->input_state[0] & INPUT_ON)) ||
-        (s->duration_mode == DURATION_SHORTEST && active_inputs != s->nb_inputs))
+        (s->duration_mode == DURATION_SHORTEST && s->active_inputs != s->nb_inputs))
         return AVERROR_EOF;
     return 0;
 }
@@ -419,7 +437,7 @@ static int request_frame(AVFilterLink *outlink)
     if (s->frame_list->nb_frames == 0) {
         ret = ff_request_frame(ctx->inputs[0]);
         if (ret == AVERROR_EOF) {
-            s->input_state[0] = 0;
+            close_input(s, 0);
             if (s->nb_inputs == 1)
                 return AVERROR_EOF;
             return output_frame(ctx->outputs[0]);
@@ -505,10 +523,12 @@ static av_cold void uninit(AVFilterContext *ctx)
             av_audio_fifo_free(s->fifos[i]);
         av_freep(&s->fifos);
     }
-    frame_list_clear(s->frame_list);
+    frame_list_free(s->frame_list);
     av_freep(&s->frame_list);
     av_freep(&s->input_state);
-    av_freep(&s->input_scale);
+    if (s->mix_buf)
+        av_freep(&s->mix_buf[0]);
+    av_freep(&s->mix_buf);
     av_freep(&s->fdsp);
 
     for (i = 0; i < ctx->nb_inputs; i++)
@@ -91,6 +91,10 @@ typedef struct {
     // input fragment position may be adjusted backwards:
     uint8_t *buffer;
 
+    // down-mixed mono samples of the ring-buffer, with the same layout,
+    // so that each input sample is down-mixed only once:
+    FFTSample *mono;
+
     // ring-buffer maximum capacity, expressed in sample rate time base:
     int ring;
 
@@ -223,6 +227,7 @@ static void yae_release_buffers(ATempoContext *atempo)
     av_freep(&atempo->frag[1].xdat);
 
     av_freep(&atempo->buffer);
+    av_freep(&atempo->mono);
     av_freep(&atempo->hann);
     av_freep(&atempo->correlation);
 
@@ -305,6 +310,7 @@ static int yae_reset(ATempoContext *atempo,
 
     atempo->ring = atempo->window * 3;
     RE_MALLOC_OR_FAIL(atempo->buffer, atempo->ring * atempo->stride);
+    RE_MALLOC_OR_FAIL(atempo->mono, atempo->ring * sizeof(FFTSample));
 
     // initialize the Hann window function:
     RE_MALLOC_OR_FAIL(atempo->hann, atempo->window * sizeof(float));
@@ -345,77 +351,61 @@ static int yae_set_tempo(AVFilterContext *ctx, const char *arg_tempo)
 }
 
 /**
- * A helper macro for initializing complex data buffer with scalar data
- * of a given type.
+ * A helper macro for down-mixing packed samples of a given type
+ * to mono, keeping the sample with the largest magnitude.
  */
-#define yae_init_xdat(scalar_type, scalar_max)                          \
+#define yae_downmix_samples(scalar_type, scalar_max)                    \
     do {                                                                \
-        const uint8_t *src_end = src +                                  \
-            frag->nsamples * atempo->channels * sizeof(scalar_type);    \
-                                                                        \
-        FFTSample *xdat = frag->xdat;                                   \
-        scalar_type tmp;                                                \
+        const scalar_type *src_end = (const scalar_type *)src +         \
+            nsamples * atempo->channels;                                \
+        const scalar_type *ptr = (const scalar_type *)src;              \
                                                                         \
         if (atempo->channels == 1) {                                    \
-            for (; src < src_end; xdat++) {                             \
-                tmp = *(const scalar_type *)src;                        \
-                src += sizeof(scalar_type);                             \
-                                                                        \
-                *xdat = (FFTSample)tmp;                                 \
-            }                                                           \
+            for (; ptr < src_end; ptr++, dst++)                         \
+                *dst = (FFTSample)*ptr;                                 \
         } else {                                                        \
             FFTSample s, max, ti, si;                                   \
             int i;                                                      \
                                                                         \
-            for (; src < src_end; xdat++) {                             \
-                tmp = *(const scalar_type *)src;                        \
-                src += sizeof(scalar_type);                             \
-                                                                        \
-                max = (FFTSample)tmp;                                   \
+            for (; ptr < src_end; dst++) {                              \
+                max = (FFTSample)*ptr++;                                \
                 s = FFMIN((FFTSample)scalar_max,                        \
                           (FFTSample)fabsf(max));                       \
                                                                         \
                 for (i = 1; i < atempo->channels; i++) {                \
-                    tmp = *(const scalar_type *)src;                    \
-                    src += sizeof(scalar_type);                         \
-                                                                        \
-                    ti = (FFTSample)tmp;                                \
+                    ti = (FFTSample)*ptr++;                             \
                     si = FFMIN((FFTSample)scalar_max,                   \
                                (FFTSample)fabsf(ti));                   \
                                                                         \
-                    if (s < si) {                                       \
-                        s   = si;                                       \
-                        max = ti;                                       \
-                    }                                                   \
+                    /* written so as to compile without branches */     \
+                    max = s < si ? ti : max;                            \
+                    s   = s < si ? si : s;                              \
                 }                                                       \
                                                                         \
-                *xdat = max;                                            \
+                *dst = max;                                             \
             }                                                           \
         }                                                               \
     } while (0)
 
 /**
- * Initialize complex data buffer of a given audio fragment
- * with down-mixed mono data of appropriate scalar type.
+ * Down-mix packed multi-channel samples to mono samples
+ * of appropriate scalar type.
  */
-static void yae_downmix(ATempoContext *atempo, AudioFragment *frag)
+static void yae_downmix(ATempoContext *atempo,
+                        FFTSample *dst,
+                        const uint8_t *src,
+                        int nsamples)
 {
-    // shortcuts:
-    const uint8_t *src = frag->data;
-
-    // init complex data buffer used for FFT and Correlation:
-    memset(frag->xdat, 0, sizeof(FFTComplex) * atempo->window);
-
     if (atempo->format == AV_SAMPLE_FMT_U8) {
-        yae_init_xdat(uint8_t, 127);
+        yae_downmix_samples(uint8_t, 127);
     } else if (atempo->format == AV_SAMPLE_FMT_S16) {
-        yae_init_xdat(int16_t, 32767);
+        yae_downmix_samples(int16_t, 32767);
     } else if (atempo->format == AV_SAMPLE_FMT_S32) {
-        yae_init_xdat(int, 2147483647);
+        yae_downmix_samples(int, 2147483647);
     } else if (atempo->format == AV_SAMPLE_FMT_FLT) {
-        yae_init_xdat(float, 1);
+        yae_downmix_samples(float, 1);
     } else if (atempo->format == AV_SAMPLE_FMT_DBL) {
-        yae_init_xdat(double, 1);
+        yae_downmix_samples(double, 1);
     }
 }
 
@@ -457,6 +447,7 @@ static int yae_load_data(ATempoContext *atempo,
         if (na) {
             uint8_t *a = atempo->buffer + atempo->tail * atempo->stride;
             memcpy(a, src, na * atempo->stride);
+            yae_downmix(atempo, atempo->mono + atempo->tail, src, na);
 
             src += na * atempo->stride;
             atempo->position[0] += na;
@@ -472,6 +463,7 @@ static int yae_load_data(ATempoContext *atempo,
         if (nb) {
             uint8_t *b = atempo->buffer;
             memcpy(b, src, nb * atempo->stride);
+            yae_downmix(atempo, atempo->mono, src, nb);
 
             src += nb * atempo->stride;
             atempo->position[0] += nb;
@@ -495,56 +487,33 @@ static int yae_load_data(ATempoContext *atempo,
 }
 
 /**
- * Populate current audio fragment data buffer.
- *
- * @return
- *   0 when the fragment is ready,
- *   AVERROR(EAGAIN) if more input data is required.
+ * Copy the samples of the current audio fragment from a ring-buffer
+ * laid out as the input ring-buffer, substituting zeros for the
+ * samples which are no longer available.
  */
-static int yae_load_frag(ATempoContext *atempo,
-                         const uint8_t **src_ref,
-                         const uint8_t *src_end)
+static void yae_copy_frag(const ATempoContext *atempo,
+                          const AudioFragment *frag,
+                          uint8_t *dst,
+                          const uint8_t *ring,
+                          int stride)
 {
-    // shortcuts:
-    AudioFragment *frag = yae_curr_frag(atempo);
-    uint8_t *dst;
-    int64_t missing, start, zeros;
-    uint32_t nsamples;
+    const int64_t start = atempo->position[0] - atempo->size;
+    const int nsamples = frag->nsamples;
+    int64_t zeros = 0;
     const uint8_t *a, *b;
     int i0, i1, n0, n1, na, nb;
 
-    int64_t stop_here = frag->position[0] + atempo->window;
-    if (src_ref && yae_load_data(atempo, src_ref, src_end, stop_here) != 0) {
-        return AVERROR(EAGAIN);
-    }
-
-    // calculate the number of samples we don't have:
-    missing =
-        stop_here > atempo->position[0] ?
-        stop_here - atempo->position[0] : 0;
-
-    nsamples =
-        missing < (int64_t)atempo->window ?
-        (uint32_t)(atempo->window - missing) : 0;
-
-    // setup the output buffer:
-    frag->nsamples = nsamples;
-    dst = frag->data;
-
-    start = atempo->position[0] - atempo->size;
-    zeros = 0;
-
     if (frag->position[0] < start) {
         // what we don't have we substitute with zeros:
         zeros = FFMIN(start - frag->position[0], (int64_t)nsamples);
         av_assert0(zeros != nsamples);
 
-        memset(dst, 0, zeros * atempo->stride);
-        dst += zeros * atempo->stride;
+        memset(dst, 0, zeros * stride);
+        dst += zeros * stride;
     }
 
     if (zeros == nsamples) {
-        return 0;
+        return;
     }
 
     // get the remaining data from the ring buffer:
@@ -557,8 +526,8 @@ static int yae_load_frag(ATempoContext *atempo,
     // sanity check:
     av_assert0(nsamples <= zeros + na + nb);
 
-    a = atempo->buffer + atempo->head * atempo->stride;
-    b = atempo->buffer;
+    a = ring + atempo->head * stride;
+    b = ring;
 
     i0 = frag->position[0] + zeros - start;
     i1 = i0 < na ? 0 : i0 - na;
@@ -567,17 +536,62 @@ static int yae_load_frag(ATempoContext *atempo,
     n1 = nsamples - zeros - n0;
 
     if (n0) {
-        memcpy(dst, a + i0 * atempo->stride, n0 * atempo->stride);
-        dst += n0 * atempo->stride;
+        memcpy(dst, a + i0 * stride, n0 * stride);
+        dst += n0 * stride;
     }
 
     if (n1) {
-        memcpy(dst, b + i1 * atempo->stride, n1 * atempo->stride);
+        memcpy(dst, b + i1 * stride, n1 * stride);
     }
+}
 
+/**
+ * Populate current audio fragment data buffer.
+ *
+ * @return
+ *   0 when the fragment is ready,
+ *   AVERROR(EAGAIN) if more input data is required.
+ */
+static int yae_load_frag(ATempoContext *atempo,
+                         const uint8_t **src_ref,
+                         const uint8_t *src_end)
+{
+    // shortcuts:
+    AudioFragment *frag = yae_curr_frag(atempo);
+    int64_t missing;
+
+    int64_t stop_here = frag->position[0] + atempo->window;
+    if (src_ref && yae_load_data(atempo, src_ref, src_end, stop_here) != 0) {
+        return AVERROR(EAGAIN);
+    }
+
+    // calculate the number of samples we don't have:
+    missing =
+        stop_here > atempo->position[0] ?
+        stop_here - atempo->position[0] : 0;
+
+    frag->nsamples =
+        missing < (int64_t)atempo->window ?
+        (uint32_t)(atempo->window - missing) : 0;
+
+    yae_copy_frag(atempo, frag, frag->data, atempo->buffer, atempo->stride);
     return 0;
 }
 
+/**
+ * Initialize complex data buffer of the current audio fragment
+ * with its down-mixed mono samples, the ring-buffer must not have
+ * changed since the fragment was loaded.
+ */
+static void yae_init_xdat(ATempoContext *atempo)
+{
+    AudioFragment *frag = yae_curr_frag(atempo);
+
+    memset(frag->xdat, 0, sizeof(FFTComplex) * atempo->window);
+    yae_copy_frag(atempo, frag, (uint8_t *)frag->xdat,
+                  (const uint8_t *)atempo->mono, sizeof(FFTSample));
+}
+
 /**
  * Prepare for loading next audio fragment.
  */
@@ -734,14 +748,12 @@ static int yae_adjust_position(ATempoContext *atempo)
         const scalar_type *aaa = (const scalar_type *)a;                \
         const scalar_type *bbb = (const scalar_type *)b;                \
                                                                         \
-        scalar_type *out     = (scalar_type *)dst;                      \
-        scalar_type *out_end = (scalar_type *)dst_end;                  \
+        scalar_type *out = (scalar_type *)dst;                          \
         int64_t i;                                                      \
                                                                         \
-        for (i = 0; i < overlap && out < out_end;                       \
-             i++, atempo->position[1]++, wa++, wb++) {                  \
-            float w0 = *wa;                                             \
-            float w1 = *wb;                                             \
+        for (i = nskip; i < nblend; i++) {                              \
+            float w0 = wa[i];                                           \
+            float w1 = wb[i];                                           \
             int j;                                                      \
                                                                         \
             for (j = 0; j < atempo->channels;                           \
@@ -749,10 +761,7 @@ static int yae_adjust_position(ATempoContext *atempo)
                 float t0 = (float)*aaa;                                 \
                 float t1 = (float)*bbb;                                 \
                                                                         \
-                *out =                                                  \
-                    frag->position[0] + i < 0 ?                         \
-                    *aaa :                                              \
-                    (scalar_type)(t0 * w0 + t1 * w1);                   \
+                *out = (scalar_type)(t0 * w0 + t1 * w1);                \
             }                                                           \
         }                                                               \
         dst = (uint8_t *)out;                                           \
@@ -793,10 +802,22 @@ static int yae_overlap_add(ATempoContext *atempo,
 
     uint8_t *dst = *dst_ref;
 
+    // number of samples to output, and number of leading samples
+    // (only in the 1st fragment) which are copied rather than blended:
+    const int64_t nblend = FFMIN(overlap, (dst_end - dst) / atempo->stride);
+    const int64_t nskip  = av_clip64(-frag->position[0], 0, nblend);
+
     av_assert0(start_here <= stop_here &&
                frag->position[1] <= start_here &&
                overlap <= frag->nsamples);
 
+    if (nskip) {
+        memcpy(dst, a, nskip * atempo->stride);
+        a   += nskip * atempo->stride;
+        b   += nskip * atempo->stride;
+        dst += nskip * atempo->stride;
+    }
+
     if (atempo->format == AV_SAMPLE_FMT_U8) {
         yae_blend(uint8_t);
     } else if (atempo->format == AV_SAMPLE_FMT_S16) {
@@ -809,6 +830,8 @@ static int yae_overlap_add(ATempoContext *atempo,
         yae_blend(double);
     }
 
+    atempo->position[1] += nblend;
+
     // pass-back the updated destination buffer pointer:
     *dst_ref = dst;
 
@@ -834,8 +857,8 @@ yae_apply(ATempoContext *atempo,
                 break;
             }
 
-            // down-mix to mono:
-            yae_downmix(atempo, yae_curr_frag(atempo));
+            // get the down-mixed mono samples:
+            yae_init_xdat(atempo);
 
             // apply rDFT:
             av_rdft_calc(atempo->real_to_complex, yae_curr_frag(atempo)->xdat);
@@ -866,8 +889,8 @@ yae_apply(ATempoContext *atempo,
                 break;
             }
 
-            // down-mix to mono:
-            yae_downmix(atempo, yae_curr_frag(atempo));
+            // get the down-mixed mono samples:
+            yae_init_xdat(atempo);
 
             // apply rDFT:
             av_rdft_calc(atempo->real_to_complex, yae_curr_frag(atempo)->xdat);
@@ -925,8 +948,8 @@ static int yae_flush(ATempoContext *atempo,
         yae_load_frag(atempo, NULL, NULL);
 
         if (atempo->nfrag) {
-            // down-mix to mono:
-            yae_downmix(atempo, frag);
+            // get the down-mixed mono samples:
+            yae_init_xdat(atempo);
 
             // apply rDFT:
             av_rdft_calc(atempo->real_to_complex, frag->xdat);
@@ -63,6 +63,8 @@
  */
 
 #include "libavutil/avassert.h"
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
 #include "libavutil/opt.h"
 #include "audio.h"
 #include "avfilter.h"
@@ -89,10 +91,27 @@ enum WidthType {
     SLOPE,
 };
 
-typedef struct ChanCache {
-    double i1, i2;
-    double o1, o2;
-} ChanCache;
+/* number of channels filtered together, stored lane by lane */
+#define BIQUAD_LANES 8
+/* number of samples per channel processed at once by all the sections */
+#define BIQUAD_BLOCK 256
+
+/**
+ * One section of the cascade for BIQUAD_LANES channels. The coefficients
+ * and the state are stored lane by lane, so that the recursion runs on
+ * all the channels of a group at once.
+ */
+typedef struct BiquadSection {
+    DECLARE_ALIGNED(32, double, b0)[BIQUAD_LANES];
+    DECLARE_ALIGNED(32, double, b1)[BIQUAD_LANES];
+    DECLARE_ALIGNED(32, double, b2)[BIQUAD_LANES];
+    DECLARE_ALIGNED(32, double, a1)[BIQUAD_LANES]; ///< negated
+    DECLARE_ALIGNED(32, double, a2)[BIQUAD_LANES]; ///< negated
+    DECLARE_ALIGNED(32, double, i1)[BIQUAD_LANES];
+    DECLARE_ALIGNED(32, double, i2)[BIQUAD_LANES];
+    DECLARE_ALIGNED(32, double, o1)[BIQUAD_LANES];
+    DECLARE_ALIGNED(32, double, o2)[BIQUAD_LANES];
+} BiquadSection;
 
 typedef struct BiquadsContext {
     const AVClass *class;
@@ -109,18 +128,25 @@ typedef struct BiquadsContext {
     double a0, a1, a2;
     double b0, b1, b2;
 
-    ChanCache *cache;
+    char *bands_str;
+    struct BiquadsContext *bands;
+    int nb_bands;
+
+    BiquadSection *sections;    ///< nb_sections sections per channel group
+    int nb_sections;
+    double (*block)[BIQUAD_LANES];
     int clippings;
 
-    void (*filter)(struct BiquadsContext *s, const void *ibuf, void *obuf, int len,
-                   double *i1, double *i2, double *o1, double *o2,
-                   double b0, double b1, double b2, double a1, double a2);
+    void (*load)(double (*dst)[BIQUAD_LANES], uint8_t **src,
+                 int nb_lanes, int offset, int len);
+    void (*store)(struct BiquadsContext *s, uint8_t **dst,
+                  double (*src)[BIQUAD_LANES], int nb_lanes, int offset, int len);
+    void (*filter)(struct BiquadsContext *s, BiquadSection *c,
+                   const void *input, void *output, int len);
 } BiquadsContext;
 
-static av_cold int init(AVFilterContext *ctx)
+static int check_params(AVFilterContext *ctx, BiquadsContext *s)
 {
-    BiquadsContext *s = ctx->priv;
-
     if (s->filter_type != biquad) {
         if (s->frequency <= 0 || s->width <= 0) {
             av_log(ctx, AV_LOG_ERROR, "Invalid frequency %f and/or width %f <= 0\n",
@@ -132,6 +158,11 @@ static av_cold int init(AVFilterContext *ctx)
     return 0;
 }
 
+static av_cold int init(AVFilterContext *ctx)
+{
+    return check_params(ctx, ctx->priv);
+}
+
 static int query_formats(AVFilterContext *ctx)
 {
     AVFilterFormats *formats;
@@ -165,23 +196,57 @@ static int query_formats(AVFilterContext *ctx)
     return ff_set_common_samplerates(ctx, formats);
 }
 
+#define BIQUAD_IO(name, type, min, max, need_clipping)                        \
+static void load_## name(double (*dst)[BIQUAD_LANES], uint8_t **src,          \
+                         int nb_lanes, int offset, int len)                   \
+{                                                                             \
+    int i, l;                                                                 \
+                                                                              \
+    for (i = 0; i < len; i++) {                                               \
+        for (l = 0; l < nb_lanes; l++)                                        \
+            dst[i][l] = ((const type *)src[l])[offset + i];                   \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static void store_## name(BiquadsContext *s, uint8_t **dst,                   \
+                          double (*src)[BIQUAD_LANES],                        \
+                          int nb_lanes, int offset, int len)                  \
+{                                                                             \
+    int i, l;                                                                 \
+                                                                              \
+    for (i = 0; i < len; i++) {                                               \
+        for (l = 0; l < nb_lanes; l++) {                                      \
+            type *obuf = (type *)dst[l] + offset;                             \
+            double o = src[i][l];                                             \
+                                                                              \
+            if (need_clipping && o < min) {                                   \
+                s->clippings++;                                               \
+                obuf[i] = min;                                                \
+            } else if (need_clipping && o > max) {                            \
+                s->clippings++;                                               \
+                obuf[i] = max;                                                \
+            } else {                                                          \
+                obuf[i] = o;                                                  \
+            }                                                                 \
+        }                                                                     \
+    }                                                                         \
+}
+
+/**
+ * Filter one channel through a single section, directly in its sample
+ * format; used for lone channels, which do not gain from the lane layout.
+ */
 #define BIQUAD_FILTER(name, type, min, max, need_clipping)                    \
-static void biquad_## name (BiquadsContext *s,                                \
-                            const void *input, void *output, int len,         \
-                            double *in1, double *in2,                         \
-                            double *out1, double *out2,                       \
-                            double b0, double b1, double b2,                  \
-                            double a1, double a2)                             \
+static void biquad_## name(BiquadsContext *s, BiquadSection *c,               \
+                           const void *input, void *output, int len)          \
 {                                                                             \
     const type *ibuf = input;                                                 \
     type *obuf = output;                                                      \
-    double i1 = *in1;                                                         \
-    double i2 = *in2;                                                         \
-    double o1 = *out1;                                                        \
-    double o2 = *out2;                                                        \
+    double b0 = c->b0[0], b1 = c->b1[0], b2 = c->b2[0];                       \
+    double a1 = c->a1[0], a2 = c->a2[0];                                      \
+    double i1 = c->i1[0], i2 = c->i2[0];                                      \
+    double o1 = c->o1[0], o2 = c->o2[0];                                      \
     int i;                                                                    \
-    a1 = -a1;                                                                 \
-    a2 = -a2;                                                                 \
                                                                               \
     for (i = 0; i+1 < len; i++) {                                             \
         o2 = i2 * b2 + i1 * b1 + ibuf[i] * b0 + o2 * a2 + o1 * a1;            \
@@ -209,7 +274,7 @@ static void biquad_## name (BiquadsContext *s,                                \
         }                                                                     \
     }                                                                         \
     if (i < len) {                                                            \
-        double o0 = ibuf[i] * b0 + i1 * b1 + i2 * b2 + o1 * a1 + o2 * a2;     \
+        double o0 = i2 * b2 + i1 * b1 + ibuf[i] * b0 + o2 * a2 + o1 * a1;     \
         i2 = i1;                                                              \
         i1 = ibuf[i];                                                         \
         o2 = o1;                                                              \
@@ -224,10 +289,10 @@ static void biquad_## name (BiquadsContext *s,                                \
             obuf[i] = o0;                                                     \
         }                                                                     \
     }                                                                         \
-    *in1  = i1;                                                               \
-    *in2  = i2;                                                               \
-    *out1 = o1;                                                               \
-    *out2 = o2;                                                               \
+    c->i1[0] = i1;                                                            \
+    c->i2[0] = i2;                                                            \
+    c->o1[0] = o1;                                                            \
+    c->o2[0] = o2;                                                            \
 }
 
 BIQUAD_FILTER(s16, int16_t, INT16_MIN, INT16_MAX, 1)
@@ -235,19 +300,100 @@ BIQUAD_FILTER(s32, int32_t, INT32_MIN, INT32_MAX, 1)
 BIQUAD_FILTER(flt, float,   -1., 1., 0)
 BIQUAD_FILTER(dbl, double,  -1., 1., 0)
 
-static int config_output(AVFilterLink *outlink)
+BIQUAD_IO(s16, int16_t, INT16_MIN, INT16_MAX, 1)
+BIQUAD_IO(s32, int32_t, INT32_MIN, INT32_MAX, 1)
+BIQUAD_IO(flt, float,   -1., 1., 0)
+BIQUAD_IO(dbl, double,  -1., 1., 0)
+
+/**
+ * Run one section over a block of samples in place. Two lanes are
+ * filtered together, which hides the latency of the recursion of each;
+ * the last lane of an odd number of lanes is filtered alone.
+ */
+static void biquad_section(BiquadSection *c, double (*buf)[BIQUAD_LANES],
+                           int nb_lanes, int len)
+{
+    int i, l;
+
+    for (l = 0; l + 1 < nb_lanes; l += 2) {
+        double b0 = c->b0[l], b0b = c->b0[l + 1];
+        double b1 = c->b1[l], b1b = c->b1[l + 1];
+        double b2 = c->b2[l], b2b = c->b2[l + 1];
+        double a1 = c->a1[l], a1b = c->a1[l + 1];
+        double a2 = c->a2[l], a2b = c->a2[l + 1];
+        double i1 = c->i1[l], i1b = c->i1[l + 1];
+        double i2 = c->i2[l], i2b = c->i2[l + 1];
+        double o1 = c->o1[l], o1b = c->o1[l + 1];
+        double o2 = c->o2[l], o2b = c->o2[l + 1];
+
+        for (i = 0; i < len; i++) {
+            double *x = &buf[i][l];
+            double o0  = i2  * b2  + i1  * b1  + x[0] * b0  + o2  * a2  + o1  * a1;
+            double o0b = i2b * b2b + i1b * b1b + x[1] * b0b + o2b * a2b + o1b * a1b;
+
+            i2  = i1;
+            i1  = x[0];
+            o2  = o1;
+            o1  = o0;
+            i2b = i1b;
+            i1b = x[1];
+            o2b = o1b;
+            o1b = o0b;
+            x[0] = o0;
+            x[1] = o0b;
+        }
+
+        c->i1[l] = i1; c->i1[l + 1] = i1b;
+        c->i2[l] = i2; c->i2[l + 1] = i2b;
+        c->o1[l] = o1; c->o1[l + 1] = o1b;
+        c->o2[l] = o2; c->o2[l + 1] = o2b;
+    }
+
+    if (l < nb_lanes) {
+        double b0 = c->b0[l], b1 = c->b1[l], b2 = c->b2[l];
+        double a1 = c->a1[l], a2 = c->a2[l];
+        double i1 = c->i1[l], i2 = c->i2[l];
+        double o1 = c->o1[l], o2 = c->o2[l];
+
+        /* unrolled so that the state rotates without moves */
+        for (i = 0; i + 1 < len; i += 2) {
+            double x0 = buf[i][l], x1 = buf[i + 1][l];
+
+            o2 = i2 * b2 + i1 * b1 + x0 * b0 + o2 * a2 + o1 * a1;
+            i2 = x0;
+            buf[i][l] = o2;
+            o1 = i1 * b2 + i2 * b1 + x1 * b0 + o1 * a2 + o2 * a1;
+            i1 = x1;
+            buf[i + 1][l] = o1;
+        }
+        if (i < len) {
+            double x0 = buf[i][l];
+            double o0 = i2 * b2 + i1 * b1 + x0 * b0 + o2 * a2 + o1 * a1;
+
+            i2 = i1;
+            i1 = x0;
+            o2 = o1;
+            o1 = o0;
+            buf[i][l] = o0;
+        }
+
+        c->i1[l] = i1;
+        c->i2[l] = i2;
+        c->o1[l] = o1;
+        c->o2[l] = o2;
+    }
+}
+
+static int calc_coeffs(AVFilterContext *ctx, BiquadsContext *s, int sample_rate)
 {
-    AVFilterContext *ctx    = outlink->src;
-    BiquadsContext *s       = ctx->priv;
-    AVFilterLink *inlink    = ctx->inputs[0];
     double A = exp(s->gain / 40 * log(10.));
-    double w0 = 2 * M_PI * s->frequency / inlink->sample_rate;
+    double w0 = 2 * M_PI * s->frequency / sample_rate;
     double alpha;
 
     if (w0 > M_PI) {
         av_log(ctx, AV_LOG_ERROR,
                "Invalid frequency %f. Frequency must be less than half the sample-rate %d.\n",
-               s->frequency, inlink->sample_rate);
+               s->frequency, sample_rate);
         return AVERROR(EINVAL);
     }
 
@@ -369,22 +515,63 @@ static int config_output(AVFilterLink *outlink)
         av_assert0(0);
     }
 
-    s->a1 /= s->a0;
-    s->a2 /= s->a0;
-    s->b0 /= s->a0;
-    s->b1 /= s->a0;
-    s->b2 /= s->a0;
+    return 0;
+}
+
+static int config_output(AVFilterLink *outlink)
+{
+    AVFilterContext *ctx    = outlink->src;
+    BiquadsContext *s       = ctx->priv;
+    AVFilterLink *inlink    = ctx->inputs[0];
+    BiquadsContext *bands   = s->nb_bands ? s->bands : s;
+    int nb_groups = (inlink->channels + BIQUAD_LANES - 1) / BIQUAD_LANES;
+    int g, l, n, ret;
+
+    s->nb_sections = FFMAX(s->nb_bands, 1);
 
-    s->cache = av_realloc_f(s->cache, sizeof(ChanCache), inlink->channels);
-    if (!s->cache)
+    av_freep(&s->sections);
+    s->sections = av_mallocz_array(nb_groups * s->nb_sections,
+                                   sizeof(*s->sections));
+    if (!s->sections)
+        return AVERROR(ENOMEM);
+
+    for (n = 0; n < s->nb_sections; n++) {
+        BiquadsContext *b = &bands[n];
+
+        if ((ret = calc_coeffs(ctx, b, inlink->sample_rate)) < 0)
+            return ret;
+
+        for (g = 0; g < nb_groups; g++) {
+            BiquadSection *c = &s->sections[g * s->nb_sections + n];
+
+            for (l = 0; l < BIQUAD_LANES; l++) {
+                c->b0[l] =  b->b0 / b->a0;
+                c->b1[l] =  b->b1 / b->a0;
+                c->b2[l] =  b->b2 / b->a0;
+                c->a1[l] = -b->a1 / b->a0;
+                c->a2[l] = -b->a2 / b->a0;
+            }
+        }
+    }
+
+    av_freep(&s->block);
+    s->block = av_malloc_array(BIQUAD_BLOCK, sizeof(*s->block));
+    if (!s->block)
         return AVERROR(ENOMEM);
-    memset(s->cache, 0, sizeof(ChanCache) * inlink->channels);
 
     switch (inlink->format) {
-    case AV_SAMPLE_FMT_S16P: s->filter = biquad_s16; break;
-    case AV_SAMPLE_FMT_S32P: s->filter = biquad_s32; break;
-    case AV_SAMPLE_FMT_FLTP: s->filter = biquad_flt; break;
-    case AV_SAMPLE_FMT_DBLP: s->filter = biquad_dbl; break;
+    case AV_SAMPLE_FMT_S16P:
+        s->load = load_s16; s->store = store_s16; s->filter = biquad_s16;
+        break;
+    case AV_SAMPLE_FMT_S32P:
+        s->load = load_s32; s->store = store_s32; s->filter = biquad_s32;
+        break;
+    case AV_SAMPLE_FMT_FLTP:
+        s->load = load_flt; s->store = store_flt; s->filter = biquad_flt;
+        break;
+    case AV_SAMPLE_FMT_DBLP:
+        s->load = load_dbl; s->store = store_dbl; s->filter = biquad_dbl;
+        break;
     default: av_assert0(0);
     }
 
@@ -398,7 +585,8 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *buf)
     AVFilterLink *outlink = ctx->outputs[0];
     AVFrame *out_buf;
     int nb_samples = buf->nb_samples;
-    int ch;
+    int channels   = av_frame_get_channels(buf);
+    int ch, n, offset;
 
     if (av_frame_is_writable(buf)) {
         out_buf = buf;
@@ -411,12 +599,25 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *buf)
         av_frame_copy_props(out_buf, buf);
     }
 
-    for (ch = 0; ch < av_frame_get_channels(buf); ch++)
-        s->filter(s, buf->extended_data[ch],
-                  out_buf->extended_data[ch], nb_samples,
-                  &s->cache[ch].i1, &s->cache[ch].i2,
-                  &s->cache[ch].o1, &s->cache[ch].o2,
-                  s->b0, s->b1, s->b2, s->a1, s->a2);
+    for (ch = 0; ch < channels; ch += BIQUAD_LANES) {
+        BiquadSection *sections = &s->sections[ch / BIQUAD_LANES * s->nb_sections];
+        int nb_lanes = FFMIN(channels - ch, BIQUAD_LANES);
+
+        if (nb_lanes == 1 && s->nb_sections == 1) {
+            s->filter(s, sections, buf->extended_data[ch],
+                      out_buf->extended_data[ch], nb_samples);
+            continue;
+        }
+
+        for (offset = 0; offset < nb_samples; offset += BIQUAD_BLOCK) {
+            int len = FFMIN(nb_samples - offset, BIQUAD_BLOCK);
+
+            s->load(s->block, buf->extended_data + ch, nb_lanes, offset, len);
+            for (n = 0; n < s->nb_sections; n++)
+                biquad_section(&sections[n], s->block, nb_lanes, len);
+            s->store(s, out_buf->extended_data + ch, s->block, nb_lanes, offset, len);
+        }
+    }
 
     if (s->clippings > 0)
         av_log(ctx, AV_LOG_WARNING, "clipping %d times. Please reduce gain.\n", s->clippings);
@@ -431,7 +632,9 @@ static av_cold void uninit(AVFilterContext *ctx)
 {
     BiquadsContext *s = ctx->priv;
 
-    av_freep(&s->cache);
+    av_freep(&s->sections);
+    av_freep(&s->block);
+    av_freep(&s->bands);
 }
 
 static const AVFilterPad inputs[] = {
@@ -477,7 +680,7 @@ AVFilter ff_af_##name_ = {                         \
     .priv_class    = &name_##_class,                     \
 }
 
-#if CONFIG_EQUALIZER_FILTER
+#if CONFIG_EQUALIZER_FILTER || CONFIG_BIQUADCHAIN_FILTER
 static const AVOption equalizer_options[] = {
     {"frequency", "set central frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=0}, 0, 999999, FLAGS},
     {"f",         "set central frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=0}, 0, 999999, FLAGS},
@@ -492,10 +695,11 @@ static const AVOption equalizer_options[] = {
     {"g",    "set gain", OFFSET(gain), AV_OPT_TYPE_DOUBLE, {.dbl=0}, -900, 900, FLAGS},
     {NULL}
 };
-
+#endif
+#if CONFIG_EQUALIZER_FILTER
 DEFINE_BIQUAD_FILTER(equalizer, "Apply two-pole peaking equalization (EQ) filter.");
 #endif  /* CONFIG_EQUALIZER_FILTER */
-#if CONFIG_BASS_FILTER
+#if CONFIG_BASS_FILTER || CONFIG_BIQUADCHAIN_FILTER
 static const AVOption bass_options[] = {
     {"frequency", "set central frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=100}, 0, 999999, FLAGS},
     {"f",         "set central frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=100}, 0, 999999, FLAGS},
@@ -510,10 +714,11 @@ static const AVOption bass_options[] = {
     {"g",    "set gain", OFFSET(gain), AV_OPT_TYPE_DOUBLE, {.dbl=0}, -900, 900, FLAGS},
     {NULL}
 };
-
+#endif
+#if CONFIG_BASS_FILTER
 DEFINE_BIQUAD_FILTER(bass, "Boost or cut lower frequencies.");
 #endif  /* CONFIG_BASS_FILTER */
-#if CONFIG_TREBLE_FILTER
+#if CONFIG_TREBLE_FILTER || CONFIG_BIQUADCHAIN_FILTER
 static const AVOption treble_options[] = {
     {"frequency", "set central frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=3000}, 0, 999999, FLAGS},
     {"f",         "set central frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=3000}, 0, 999999, FLAGS},
@@ -528,10 +733,11 @@ static const AVOption treble_options[] = {
     {"g",    "set gain", OFFSET(gain), AV_OPT_TYPE_DOUBLE, {.dbl=0}, -900, 900, FLAGS},
     {NULL}
 };
-
+#endif
+#if CONFIG_TREBLE_FILTER
 DEFINE_BIQUAD_FILTER(treble, "Boost or cut upper frequencies.");
 #endif  /* CONFIG_TREBLE_FILTER */
-#if CONFIG_BANDPASS_FILTER
+#if CONFIG_BANDPASS_FILTER || CONFIG_BIQUADCHAIN_FILTER
 static const AVOption bandpass_options[] = {
     {"frequency", "set central frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=3000}, 0, 999999, FLAGS},
     {"f",         "set central frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=3000}, 0, 999999, FLAGS},
@@ -545,10 +751,11 @@ static const AVOption bandpass_options[] = {
     {"csg",   "use constant skirt gain", OFFSET(csg), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, FLAGS},
     {NULL}
 };
-
+#endif
+#if CONFIG_BANDPASS_FILTER
 DEFINE_BIQUAD_FILTER(bandpass, "Apply a two-pole Butterworth band-pass filter.");
 #endif  /* CONFIG_BANDPASS_FILTER */
-#if CONFIG_BANDREJECT_FILTER
+#if CONFIG_BANDREJECT_FILTER || CONFIG_BIQUADCHAIN_FILTER
 static const AVOption bandreject_options[] = {
     {"frequency", "set central frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=3000}, 0, 999999, FLAGS},
     {"f",         "set central frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=3000}, 0, 999999, FLAGS},
@@ -561,10 +768,11 @@ static const AVOption bandreject_options[] = {
     {"w",     "set band-width", OFFSET(width), AV_OPT_TYPE_DOUBLE, {.dbl=0.5}, 0, 999, FLAGS},
     {NULL}
 };
-
+#endif
+#if CONFIG_BANDREJECT_FILTER
 DEFINE_BIQUAD_FILTER(bandreject, "Apply a two-pole Butterworth band-reject filter.");
 #endif  /* CONFIG_BANDREJECT_FILTER */
-#if CONFIG_LOWPASS_FILTER
+#if CONFIG_LOWPASS_FILTER || CONFIG_BIQUADCHAIN_FILTER
 static const AVOption lowpass_options[] = {
     {"frequency", "set frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=500}, 0, 999999, FLAGS},
     {"f",         "set frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=500}, 0, 999999, FLAGS},
@@ -579,10 +787,11 @@ static const AVOption lowpass_options[] = {
     {"p",     "set number of poles", OFFSET(poles), AV_OPT_TYPE_INT, {.i64=2}, 1, 2, FLAGS},
     {NULL}
 };
-
+#endif
+#if CONFIG_LOWPASS_FILTER
 DEFINE_BIQUAD_FILTER(lowpass, "Apply a low-pass filter with 3dB point frequency.");
 #endif  /* CONFIG_LOWPASS_FILTER */
-#if CONFIG_HIGHPASS_FILTER
+#if CONFIG_HIGHPASS_FILTER || CONFIG_BIQUADCHAIN_FILTER
 static const AVOption highpass_options[] = {
     {"frequency", "set frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=3000}, 0, 999999, FLAGS},
     {"f",         "set frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=3000}, 0, 999999, FLAGS},
@@ -597,10 +806,11 @@ static const AVOption highpass_options[] = {
     {"p",     "set number of poles", OFFSET(poles), AV_OPT_TYPE_INT, {.i64=2}, 1, 2, FLAGS},
     {NULL}
 };
-
+#endif
+#if CONFIG_HIGHPASS_FILTER
 DEFINE_BIQUAD_FILTER(highpass, "Apply a high-pass filter with 3dB point frequency.");
 #endif  /* CONFIG_HIGHPASS_FILTER */
-#if CONFIG_ALLPASS_FILTER
+#if CONFIG_ALLPASS_FILTER || CONFIG_BIQUADCHAIN_FILTER
 static const AVOption allpass_options[] = {
     {"frequency", "set central frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=3000}, 0, 999999, FLAGS},
     {"f",         "set central frequency", OFFSET(frequency), AV_OPT_TYPE_DOUBLE, {.dbl=3000}, 0, 999999, FLAGS},
@@ -613,10 +823,11 @@ static const AVOption allpass_options[] = {
     {"w",     "set filter-width", OFFSET(width), AV_OPT_TYPE_DOUBLE, {.dbl=707.1}, 0, 99999, FLAGS},
     {NULL}
 };
-
+#endif
+#if CONFIG_ALLPASS_FILTER
 DEFINE_BIQUAD_FILTER(allpass, "Apply a two-pole all-pass filter.");
 #endif  /* CONFIG_ALLPASS_FILTER */
-#if CONFIG_BIQUAD_FILTER
+#if CONFIG_BIQUAD_FILTER || CONFIG_BIQUADCHAIN_FILTER
 static const AVOption biquad_options[] = {
     {"a0", NULL, OFFSET(a0), AV_OPT_TYPE_DOUBLE, {.dbl=1}, INT16_MIN, INT16_MAX, FLAGS},
     {"a1", NULL, OFFSET(a1), AV_OPT_TYPE_DOUBLE, {.dbl=1}, INT16_MIN, INT16_MAX, FLAGS},
@@ -626,6 +837,127 @@ static const AVOption biquad_options[] = {
     {"b2", NULL, OFFSET(b2), AV_OPT_TYPE_DOUBLE, {.dbl=1}, INT16_MIN, INT16_MAX, FLAGS},
     {NULL}
 };
-
+#endif
+#if CONFIG_BIQUAD_FILTER
 DEFINE_BIQUAD_FILTER(biquad, "Apply a biquad IIR filter with the given coefficients.");
 #endif  /* CONFIG_BIQUAD_FILTER */
+#if CONFIG_BIQUADCHAIN_FILTER
+#define BAND_TYPE(name_) {                                              \
+    #name_, name_, {                                                    \
+        .class_name = #name_,                                           \
+        .item_name  = av_default_item_name,                             \
+        .option     = name_##_options,                                  \
+        .version    = LIBAVUTIL_VERSION_INT,                            \
+    }                                                                   \
+}
+
+static const struct {
+    const char *name;
+    enum FilterType type;
+    AVClass class;
+} band_types[] = {
+    BAND_TYPE(equalizer),
+    BAND_TYPE(bass),
+    BAND_TYPE(treble),
+    BAND_TYPE(bandpass),
+    BAND_TYPE(bandreject),
+    BAND_TYPE(lowpass),
+    BAND_TYPE(highpass),
+    BAND_TYPE(allpass),
+    BAND_TYPE(biquad),
+};
+
+static av_cold int biquadchain_init(AVFilterContext *ctx)
+{
+    BiquadsContext *s = ctx->priv;
+    char *args, *band, *opt, *saveptr = NULL, *saveptr2;
+    int i, ret = 0;
+
+    if (!s->bands_str) {
+        av_log(ctx, AV_LOG_ERROR, "No bands specified.\n");
+        return AVERROR(EINVAL);
+    }
+
+    args = av_strdup(s->bands_str);
+    if (!args)
+        return AVERROR(ENOMEM);
+
+    for (band = av_strtok(args, "|", &saveptr); band;
+         band = av_strtok(NULL, "|", &saveptr)) {
+        BiquadsContext *b;
+        size_t len;
+
+        band += strspn(band, " ");
+        len   = strcspn(band, " ");
+        for (i = 0; i < FF_ARRAY_ELEMS(band_types); i++)
+            if (strlen(band_types[i].name) == len &&
+                !strncmp(band, band_types[i].name, len))
+                break;
+        if (i == FF_ARRAY_ELEMS(band_types)) {
+            av_log(ctx, AV_LOG_ERROR, "Unknown filter type '%.*s'.\n",
+                   (int)len, band);
+            ret = AVERROR(EINVAL);
+            break;
+        }
+
+        ret = av_reallocp_array(&s->bands, s->nb_bands + 1, sizeof(*s->bands));
+        if (ret < 0) {
+            s->nb_bands = 0;
+            break;
+        }
+        b = &s->bands[s->nb_bands++];
+        memset(b, 0, sizeof(*b));
+        b->class       = &band_types[i].class;
+        b->filter_type = band_types[i].type;
+        av_opt_set_defaults(b);
+
+        for (opt = av_strtok(band + len, " ", &saveptr2); opt;
+             opt = av_strtok(NULL, " ", &saveptr2)) {
+            char *val = strchr(opt, '=');
+
+            if (!val) {
+                av_log(ctx, AV_LOG_ERROR, "No value for option '%s' of band %d.\n",
+                       opt, s->nb_bands);
+                ret = AVERROR(EINVAL);
+                break;
+            }
+            *val++ = 0;
+            if ((ret = av_opt_set(b, opt, val, 0)) < 0) {
+                av_log(ctx, AV_LOG_ERROR, "Invalid option '%s' for band %d.\n",
+                       opt, s->nb_bands);
+                break;
+            }
+        }
+        if (ret < 0 || (ret = check_params(ctx, b)) < 0)
+            break;
+    }
+    av_free(args);
+
+    if (ret >= 0 && !s->nb_bands) {
+        av_log(ctx, AV_LOG_ERROR, "No bands specified.\n");
+        ret = AVERROR(EINVAL);
+    }
+
+    return ret;
+}
+
+static const AVOption biquadchain_options[] = {
+    {"bands", "set the filters to apply, separated by '|'", OFFSET(bands_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS},
+    {"b",     "set the filters to apply, separated by '|'", OFFSET(bands_str), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS},
+    {NULL}
+};
+
+AVFILTER_DEFINE_CLASS(biquadchain);
+
+AVFilter ff_af_biquadchain = {
+    .name          = "biquadchain",
+    .description   = NULL_IF_CONFIG_SMALL("Apply a chain of biquad filters in a single pass."),
+    .priv_size     = sizeof(BiquadsContext),
+    .init          = biquadchain_init,
+    .uninit        = uninit,
+    .query_formats = query_formats,
+    .inputs        = inputs,
+    .outputs       = outputs,
+    .priv_class    = &biquadchain_class,
+};
+#endif  /* CONFIG_BIQUADCHAIN_FILTER */
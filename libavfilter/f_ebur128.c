@@ -37,7 +37,6 @@
 #include "libavutil/xga_font_data.h"
 #include "libavutil/opt.h"
 #include "libavutil/timestamp.h"
-#include "libswresample/swresample.h"
 #include "audio.h"
 #include "avfilter.h"
 #include "formats.h"
@@ -59,6 +58,25 @@
 #define RLB_A1 -1.99004745483398
 #define RLB_A2  0.99007225036621
 
+/* true-peak interpolation filter, 4x over-sampling with 12 taps per phase
+ * (ITU-R BS.1770-4 Annex 2) */
+#define TP_TAPS 12
+#define TP_BUF_SIZE (TP_TAPS - 1 + 4800)
+static const double tp_coeffs[4][TP_TAPS] = {
+    {  0.0017089843750,  0.0109863281250, -0.0196533203125,  0.0332031250000,
+      -0.0594482421875,  0.1373291015625,  0.9721679687500, -0.1022949218750,
+       0.0476074218750, -0.0266113281250,  0.0148925781250, -0.0083007812500 },
+    { -0.0291748046875,  0.0292968750000, -0.0517578125000,  0.0891113281250,
+      -0.1665039062500,  0.4650878906250,  0.7797851562500, -0.2003173828125,
+       0.1015625000000, -0.0582275390625,  0.0330810546875, -0.0189208984375 },
+    { -0.0189208984375,  0.0330810546875, -0.0582275390625,  0.1015625000000,
+      -0.2003173828125,  0.7797851562500,  0.4650878906250, -0.1665039062500,
+       0.0891113281250, -0.0517578125000,  0.0292968750000, -0.0291748046875 },
+    { -0.0083007812500,  0.0148925781250, -0.0266113281250,  0.0476074218750,
+      -0.1022949218750,  0.9721679687500,  0.1373291015625, -0.0594482421875,
+       0.0332031250000, -0.0196533203125,  0.0109863281250,  0.0017089843750 },
+};
+
 #define ABS_THRES    -70            ///< silence gate: we discard anything below this absolute (LUFS) threshold
 #define ABS_UP_THRES  10            ///< upper loud limit to consider (ABS_THRES being the minimum)
 #define HIST_GRAIN   100            ///< defines histogram precision
@@ -98,11 +116,9 @@ typedef struct {
     double *true_peaks;             ///< true peaks per channel
     double *sample_peaks;           ///< sample peaks per channel
     double *true_peaks_per_frame;   ///< true peaks in a frame per channel
-#if CONFIG_SWRESAMPLE
-    SwrContext *swr_ctx;            ///< over-sampling context for true peak metering
-    double *swr_buf;                ///< resampled audio data for true peak metering
-    int swr_linesize;
-#endif
+    double *tp_buf;                 ///< per channel, last input samples for the true peak interpolation
+    double tp_sum[2][TP_TAPS / 2];  ///< sums of symmetric interpolation coefficients
+    double tp_diff[2][TP_TAPS / 2]; ///< differences of symmetric interpolation coefficients
 
     /* video  */
     int do_video;                   ///< 1 if video output enabled, 0 otherwise
@@ -139,6 +155,7 @@ typedef struct {
 
     /* misc */
     int loglevel;                   ///< log level for frame logging
+    int need_results;               ///< whether I and LRA are needed at each update
     int metadata;                   ///< whether or not to inject loudness results in frames
     int dual_mono;                  ///< whether or not to treat single channel input files as dual-mono
     double pan_law;                 ///< pan law value used to calculate dual-mono measurements
@@ -401,31 +418,23 @@ static int config_audio_output(AVFilterLink *outlink)
             return AVERROR(ENOMEM);
     }
 
-#if CONFIG_SWRESAMPLE
     if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS) {
-        int ret;
-
-        ebur128->swr_buf    = av_malloc_array(nb_channels, 19200 * sizeof(double));
+        ebur128->tp_buf     = av_calloc(nb_channels, TP_BUF_SIZE * sizeof(*ebur128->tp_buf));
         ebur128->true_peaks = av_calloc(nb_channels, sizeof(*ebur128->true_peaks));
         ebur128->true_peaks_per_frame = av_calloc(nb_channels, sizeof(*ebur128->true_peaks_per_frame));
-        ebur128->swr_ctx    = swr_alloc();
-        if (!ebur128->swr_buf || !ebur128->true_peaks ||
-            !ebur128->true_peaks_per_frame || !ebur128->swr_ctx)
+        if (!ebur128->tp_buf || !ebur128->true_peaks || !ebur128->true_peaks_per_frame)
             return AVERROR(ENOMEM);
 
-        av_opt_set_int(ebur128->swr_ctx, "in_channel_layout",    outlink->channel_layout, 0);
-        av_opt_set_int(ebur128->swr_ctx, "in_sample_rate",       outlink->sample_rate, 0);
-        av_opt_set_sample_fmt(ebur128->swr_ctx, "in_sample_fmt", outlink->format, 0);
-
-        av_opt_set_int(ebur128->swr_ctx, "out_channel_layout",    outlink->channel_layout, 0);
-        av_opt_set_int(ebur128->swr_ctx, "out_sample_rate",       192000, 0);
-        av_opt_set_sample_fmt(ebur128->swr_ctx, "out_sample_fmt", outlink->format, 0);
+        /* the phases are symmetric: phase 3 - p is phase p reversed */
+        for (i = 0; i < 2; i++) {
+            int j;
 
-        ret = swr_init(ebur128->swr_ctx);
-        if (ret < 0)
-            return ret;
+            for (j = 0; j < TP_TAPS / 2; j++) {
+                ebur128->tp_sum [i][j] = tp_coeffs[i][j] + tp_coeffs[i][TP_TAPS - 1 - j];
+                ebur128->tp_diff[i][j] = tp_coeffs[i][j] - tp_coeffs[i][TP_TAPS - 1 - j];
+            }
+        }
     }
-#endif
 
     if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS) {
         ebur128->sample_peaks = av_calloc(nb_channels, sizeof(*ebur128->sample_peaks));
@@ -467,11 +476,10 @@ static av_cold int init(AVFilterContext *ctx)
             ebur128->loglevel = AV_LOG_INFO;
     }
 
-    if (!CONFIG_SWRESAMPLE && (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS)) {
-        av_log(ctx, AV_LOG_ERROR,
-               "True-peak mode requires libswresample to be performed\n");
-        return AVERROR(EINVAL);
-    }
+    /* the integrated loudness and loudness range are otherwise only computed
+     * for the summary */
+    ebur128->need_results = ebur128->do_video || ebur128->metadata ||
+                            av_log_get_level() >= ebur128->loglevel;
 
     // if meter is  +9 scale, scale range is from -18 LU to  +9 LU (or 3*9)
     // if meter is +18 scale, scale range is from -36 LU to +18 LU (or 3*18)
@@ -515,12 +523,11 @@ static av_cold int init(AVFilterContext *ctx)
 
 /* loudness and power should be set such as loudness = -0.691 +
  * 10*log10(power), we just avoid doing that calculus two times */
-static int gate_update(struct integrator *integ, double power,
-                       double loudness, int gate_thres)
+static void gate_update(struct integrator *integ, double power,
+                        double loudness, int gate_thres)
 {
     int ipower;
     double relative_threshold;
-    int gate_hist_pos;
 
     /* update powers histograms by incrementing current power count */
     ipower = av_clip(HIST_POS(loudness), 0, HIST_SIZE - 1);
@@ -533,104 +540,259 @@ static int gate_update(struct integrator *integ, double power,
     if (!relative_threshold)
         relative_threshold = 1e-12;
     integ->rel_threshold = LOUDNESS(relative_threshold) + gate_thres;
-    gate_hist_pos = av_clip(HIST_POS(integ->rel_threshold), 0, HIST_SIZE - 1);
+}
 
-    return gate_hist_pos;
+/* the gate position in the histogram follows the last relative threshold */
+#define GATE_HIST_POS(integ) av_clip(HIST_POS((integ)->rel_threshold), 0, HIST_SIZE - 1)
+
+static void update_integrated_loudness(EBUR128Context *ebur128)
+{
+    const struct integrator *integ = &ebur128->i400;
+    const int gate_hist_pos = GATE_HIST_POS(integ);
+    double integrated_sum = 0;
+    int nb_integrated = 0;
+    int i;
+
+    /* compute integrated loudness by summing the histogram values
+     * above the relative threshold */
+    for (i = gate_hist_pos; i < HIST_SIZE; i++) {
+        const int nb_v = integ->histogram[i].count;
+        nb_integrated  += nb_v;
+        integrated_sum += nb_v * integ->histogram[i].energy;
+    }
+    if (nb_integrated) {
+        ebur128->integrated_loudness = LOUDNESS(integrated_sum / nb_integrated);
+        /* dual-mono correction */
+        if (ebur128->nb_channels == 1 && ebur128->dual_mono) {
+            ebur128->integrated_loudness -= ebur128->pan_law;
+        }
+    }
 }
 
-static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
+#define LRA_LOWER_PRC   10
+#define LRA_HIGHER_PRC  95
+
+static void update_loudness_range(EBUR128Context *ebur128)
 {
-    int i, ch, idx_insample;
-    AVFilterContext *ctx = inlink->dst;
-    EBUR128Context *ebur128 = ctx->priv;
-    const int nb_channels = ebur128->nb_channels;
-    const int nb_samples  = insamples->nb_samples;
-    const double *samples = (double *)insamples->data[0];
-    AVFrame *pic = ebur128->outpicref;
+    const struct integrator *integ = &ebur128->i3000;
+    const int gate_hist_pos = GATE_HIST_POS(integ);
+    int nb_powers = 0;
+    int i;
 
-#if CONFIG_SWRESAMPLE
-    if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS) {
-        const double *swr_samples = ebur128->swr_buf;
-        int ret = swr_convert(ebur128->swr_ctx, (uint8_t**)&ebur128->swr_buf, 19200,
-                              (const uint8_t **)insamples->data, nb_samples);
-        if (ret < 0)
-            return ret;
-        for (ch = 0; ch < nb_channels; ch++)
-            ebur128->true_peaks_per_frame[ch] = 0.0;
-        for (idx_insample = 0; idx_insample < ret; idx_insample++) {
-            for (ch = 0; ch < nb_channels; ch++) {
-                ebur128->true_peaks[ch] = FFMAX(ebur128->true_peaks[ch], fabs(*swr_samples));
-                ebur128->true_peaks_per_frame[ch] = FFMAX(ebur128->true_peaks_per_frame[ch],
-                                                          fabs(*swr_samples));
-                swr_samples++;
+    for (i = gate_hist_pos; i < HIST_SIZE; i++)
+        nb_powers += integ->histogram[i].count;
+    if (nb_powers) {
+        int n, nb_pow;
+
+        /* get lower loudness to consider */
+        n = 0;
+        nb_pow = LRA_LOWER_PRC  * nb_powers / 100. + 0.5;
+        for (i = gate_hist_pos; i < HIST_SIZE; i++) {
+            n += integ->histogram[i].count;
+            if (n >= nb_pow) {
+                ebur128->lra_low = integ->histogram[i].loudness;
+                break;
             }
         }
+
+        /* get higher loudness to consider */
+        n = nb_powers;
+        nb_pow = LRA_HIGHER_PRC * nb_powers / 100. + 0.5;
+        for (i = HIST_SIZE - 1; i >= 0; i--) {
+            n -= integ->histogram[i].count;
+            if (n < nb_pow) {
+                ebur128->lra_high = integ->histogram[i].loudness;
+                break;
+            }
+        }
+
+        // XXX: show low & high on the graph?
+        ebur128->loudness_range = ebur128->lra_high - ebur128->lra_low;
     }
-#endif
+}
 
-    for (idx_insample = 0; idx_insample < nb_samples; idx_insample++) {
-        const int bin_id_400  = ebur128->i400.cache_pos;
-        const int bin_id_3000 = ebur128->i3000.cache_pos;
+/**
+ * Return the maximum of the 4x oversampled signal in buf, which holds
+ * TP_TAPS - 1 history samples followed by nb_samples new ones, using the
+ * interpolation filter of ITU-R BS.1770-4 Annex 2.
+ */
+static double true_peak(const EBUR128Context *ebur128, const double *buf, int nb_samples)
+{
+    double peak = 0;
+    int i, j, q;
 
-#define MOVE_TO_NEXT_CACHED_ENTRY(time) do {                \
-    ebur128->i##time.cache_pos++;                           \
-    if (ebur128->i##time.cache_pos == I##time##_BINS) {     \
-        ebur128->i##time.filled    = 1;                     \
-        ebur128->i##time.cache_pos = 0;                     \
-    }                                                       \
-} while (0)
+    for (i = 0; i < nb_samples; i++) {
+        const double *b = buf + i;
+        double s[TP_TAPS / 2], d[TP_TAPS / 2];
 
-        MOVE_TO_NEXT_CACHED_ENTRY(400);
-        MOVE_TO_NEXT_CACHED_ENTRY(3000);
+        for (j = 0; j < TP_TAPS / 2; j++) {
+            s[j] = b[j] + b[TP_TAPS - 1 - j];
+            d[j] = b[j] - b[TP_TAPS - 1 - j];
+        }
+
+        /* phases q and 3 - q are (P + M) / 2 and (P - M) / 2 */
+        for (q = 0; q < 2; q++) {
+            double p = 0, m = 0;
+
+            for (j = 0; j < TP_TAPS / 2; j++) {
+                p += ebur128->tp_sum [q][j] * s[j];
+                m += ebur128->tp_diff[q][j] * d[j];
+            }
+            peak = FFMAX(peak, 0.5 * (fabs(p) + fabs(m)));
+        }
+    }
 
-        for (ch = 0; ch < nb_channels; ch++) {
-            double bin;
+    return peak;
+}
 
-            if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS)
-                ebur128->sample_peaks[ch] = FFMAX(ebur128->sample_peaks[ch], fabs(*samples));
+typedef struct ThreadData {
+    const double *samples;          ///< interleaved input samples
+    int nb_samples;
+    int bin_id_400, bin_id_3000;    ///< cache positions of the first sample
+} ThreadData;
 
-            ebur128->x[ch * 3] = *samples++; // set X[i]
+static int filter_channels(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    EBUR128Context *ebur128 = ctx->priv;
+    ThreadData *td = arg;
+    const int nb_channels = ebur128->nb_channels;
+    const int nb_samples  = td->nb_samples;
+    const int start = (nb_channels *  jobnr   ) / nb_jobs;
+    const int end   = (nb_channels * (jobnr+1)) / nb_jobs;
+    int ch, i;
+
+    for (ch = start; ch < end; ch++) {
+        const double *samples = td->samples + ch;
+        double *cache_400  = ebur128->i400.cache [ch];
+        double *cache_3000 = ebur128->i3000.cache[ch];
+        int bin_id_400  = td->bin_id_400;
+        int bin_id_3000 = td->bin_id_3000;
+        double sum_400, sum_3000;
+        double x1, x2, y1, y2, z1, z2;
+
+        if (ebur128->peak_mode & PEAK_MODE_SAMPLES_PEAKS) {
+            double peak = ebur128->sample_peaks[ch];
+
+            for (i = 0; i < nb_samples; i++)
+                peak = FFMAX(peak, fabs(samples[i * nb_channels]));
+            ebur128->sample_peaks[ch] = peak;
+        }
 
-            if (!ebur128->ch_weighting[ch])
-                continue;
+        if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS) {
+            double *buf = ebur128->tp_buf + ch * TP_BUF_SIZE;
+            double peak;
 
-            /* Y[i] = X[i]*b0 + X[i-1]*b1 + X[i-2]*b2 - Y[i-1]*a1 - Y[i-2]*a2 */
-#define FILTER(Y, X, name) do {                                                 \
-            double *dst = ebur128->Y + ch*3;                                    \
-            double *src = ebur128->X + ch*3;                                    \
-            dst[2] = dst[1];                                                    \
-            dst[1] = dst[0];                                                    \
-            dst[0] = src[0]*name##_B0 + src[1]*name##_B1 + src[2]*name##_B2     \
-                                      - dst[1]*name##_A1 - dst[2]*name##_A2;    \
-} while (0)
+            for (i = 0; i < nb_samples; i++)
+                buf[TP_TAPS - 1 + i] = samples[i * nb_channels];
+            peak = true_peak(ebur128, buf, nb_samples);
+            memmove(buf, buf + nb_samples, (TP_TAPS - 1) * sizeof(*buf));
+
+            ebur128->true_peaks[ch] = FFMAX(ebur128->true_peaks[ch], peak);
+            ebur128->true_peaks_per_frame[ch] = FFMAX(ebur128->true_peaks_per_frame[ch], peak);
+        }
 
-            // TODO: merge both filters in one?
-            FILTER(y, x, PRE);  // apply pre-filter
-            ebur128->x[ch * 3 + 2] = ebur128->x[ch * 3 + 1];
-            ebur128->x[ch * 3 + 1] = ebur128->x[ch * 3    ];
-            FILTER(z, y, RLB);  // apply RLB-filter
+        if (!ebur128->ch_weighting[ch])
+            continue;
+
+        x1 = ebur128->x[ch * 3 + 1];
+        x2 = ebur128->x[ch * 3 + 2];
+        y1 = ebur128->y[ch * 3    ];
+        y2 = ebur128->y[ch * 3 + 1];
+        z1 = ebur128->z[ch * 3    ];
+        z2 = ebur128->z[ch * 3 + 1];
+        sum_400  = ebur128->i400.sum [ch];
+        sum_3000 = ebur128->i3000.sum[ch];
 
-            bin = ebur128->z[ch * 3] * ebur128->z[ch * 3];
+        for (i = 0; i < nb_samples; i++) {
+            const double x0 = samples[i * nb_channels];
+            double y0, z0, bin;
+
+            /* Y[i] = X[i]*b0 + X[i-1]*b1 + X[i-2]*b2 - Y[i-1]*a1 - Y[i-2]*a2 */
+            y0 = x0*PRE_B0 + x1*PRE_B1 + x2*PRE_B2 - y1*PRE_A1 - y2*PRE_A2; // apply pre-filter
+            z0 = y0*RLB_B0 + y1*RLB_B1 + y2*RLB_B2 - z1*RLB_A1 - z2*RLB_A2; // apply RLB-filter
+            x2 = x1; x1 = x0;
+            y2 = y1; y1 = y0;
+            z2 = z1; z1 = z0;
+
+            bin = z0 * z0;
 
             /* add the new value, and limit the sum to the cache size (400ms or 3s)
              * by removing the oldest one */
-            ebur128->i400.sum [ch] = ebur128->i400.sum [ch] + bin - ebur128->i400.cache [ch][bin_id_400];
-            ebur128->i3000.sum[ch] = ebur128->i3000.sum[ch] + bin - ebur128->i3000.cache[ch][bin_id_3000];
+            sum_400  = sum_400  + bin - cache_400 [bin_id_400];
+            sum_3000 = sum_3000 + bin - cache_3000[bin_id_3000];
 
             /* override old cache entry with the new value */
-            ebur128->i400.cache [ch][bin_id_400 ] = bin;
-            ebur128->i3000.cache[ch][bin_id_3000] = bin;
+            cache_400 [bin_id_400 ] = bin;
+            cache_3000[bin_id_3000] = bin;
+
+            if (++bin_id_400 == I400_BINS)
+                bin_id_400 = 0;
+            if (++bin_id_3000 == I3000_BINS)
+                bin_id_3000 = 0;
         }
 
+        ebur128->x[ch * 3 + 1] = x1;
+        ebur128->x[ch * 3 + 2] = x2;
+        ebur128->y[ch * 3    ] = y1;
+        ebur128->y[ch * 3 + 1] = y2;
+        ebur128->z[ch * 3    ] = z1;
+        ebur128->z[ch * 3 + 1] = z2;
+        ebur128->i400.sum [ch] = sum_400;
+        ebur128->i3000.sum[ch] = sum_3000;
+    }
+
+    return 0;
+}
+
+static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
+{
+    int ch, idx_insample, len;
+    AVFilterContext *ctx = inlink->dst;
+    EBUR128Context *ebur128 = ctx->priv;
+    const int nb_channels = ebur128->nb_channels;
+    const int nb_samples  = insamples->nb_samples;
+    const double *samples = (double *)insamples->data[0];
+    AVFrame *pic = ebur128->outpicref;
+
+    if (ebur128->peak_mode & PEAK_MODE_TRUE_PEAKS)
+        for (ch = 0; ch < nb_channels; ch++)
+            ebur128->true_peaks_per_frame[ch] = 0.0;
+
+    /* The frame is processed in segments ending at the 100ms boundaries where
+     * the loudness is updated; the channels of a segment are independent. */
+    for (idx_insample = 0; idx_insample < nb_samples; idx_insample += len) {
+        ThreadData td;
+
+        len = FFMIN(nb_samples - idx_insample, 4800 - ebur128->sample_count);
+
+        td.samples     = samples + idx_insample * nb_channels;
+        td.nb_samples  = len;
+        td.bin_id_400  = ebur128->i400.cache_pos;
+        td.bin_id_3000 = ebur128->i3000.cache_pos;
+        ctx->internal->execute(ctx, filter_channels, &td, NULL,
+                               FFMIN(nb_channels, ff_filter_get_nb_threads(ctx)));
+
+#define MOVE_TO_NEXT_CACHED_ENTRY(time) do {                \
+    ebur128->i##time.cache_pos += len;                      \
+    if (ebur128->i##time.cache_pos >= I##time##_BINS) {     \
+        ebur128->i##time.filled     = 1;                    \
+        ebur128->i##time.cache_pos -= I##time##_BINS;       \
+    }                                                       \
+} while (0)
+
+        MOVE_TO_NEXT_CACHED_ENTRY(400);
+        MOVE_TO_NEXT_CACHED_ENTRY(3000);
+
         /* For integrated loudness, gating blocks are 400ms long with 75%
          * overlap (see BS.1770-2 p5), so a re-computation is needed each 100ms
          * (4800 samples at 48kHz). */
-        if (++ebur128->sample_count == 4800) {
+        ebur128->sample_count += len;
+        if (ebur128->sample_count == 4800) {
             double loudness_400, loudness_3000;
             double power_400 = 1e-12, power_3000 = 1e-12;
             AVFilterLink *outlink = ctx->outputs[0];
             const int64_t pts = insamples->pts +
-                av_rescale_q(idx_insample, (AVRational){ 1, inlink->sample_rate },
+                av_rescale_q(idx_insample + len - 1, (AVRational){ 1, inlink->sample_rate },
                              outlink->time_base);
 
             ebur128->sample_count = 0;
@@ -652,69 +814,20 @@ static int filter_frame(AVFilterLink *inlink, AVFrame *insamples)
 #define I_GATE_THRES -10  // initially defined to -8 LU in the first EBU standard
 
             if (loudness_400 >= ABS_THRES) {
-                double integrated_sum = 0;
-                int nb_integrated = 0;
-                int gate_hist_pos = gate_update(&ebur128->i400, power_400,
-                                                loudness_400, I_GATE_THRES);
-
-                /* compute integrated loudness by summing the histogram values
-                 * above the relative threshold */
-                for (i = gate_hist_pos; i < HIST_SIZE; i++) {
-                    const int nb_v = ebur128->i400.histogram[i].count;
-                    nb_integrated  += nb_v;
-                    integrated_sum += nb_v * ebur128->i400.histogram[i].energy;
-                }
-                if (nb_integrated) {
-                    ebur128->integrated_loudness = LOUDNESS(integrated_sum / nb_integrated);
-                    /* dual-mono correction */
-                    if (nb_channels == 1 && ebur128->dual_mono) {
-                        ebur128->integrated_loudness -= ebur128->pan_law;
-                    }
-                }
+                gate_update(&ebur128->i400, power_400, loudness_400, I_GATE_THRES);
+                if (ebur128->need_results)
+                    update_integrated_loudness(ebur128);
             }
 
             /* LRA */
 #define LRA_GATE_THRES -20
-#define LRA_LOWER_PRC   10
-#define LRA_HIGHER_PRC  95
 
             /* XXX: example code in EBU 3342 is ">=" but formula in BS.1770
              * specs is ">" */
             if (loudness_3000 >= ABS_THRES) {
-                int nb_powers = 0;
-                int gate_hist_pos = gate_update(&ebur128->i3000, power_3000,
-                                                loudness_3000, LRA_GATE_THRES);
-
-                for (i = gate_hist_pos; i < HIST_SIZE; i++)
-                    nb_powers += ebur128->i3000.histogram[i].count;
-                if (nb_powers) {
-                    int n, nb_pow;
-
-                    /* get lower loudness to consider */
-                    n = 0;
-                    nb_pow = LRA_LOWER_PRC  * nb_powers / 100. + 0.5;
-                    for (i = gate_hist_pos; i < HIST_SIZE; i++) {
-                        n += ebur128->i3000.histogram[i].count;
-                        if (n >= nb_pow) {
-                            ebur128->lra_low = ebur128->i3000.histogram[i].loudness;
-                            break;
-                        }
-                    }
-
-                    /* get higher loudness to consider */
-                    n = nb_powers;
-                    nb_pow = LRA_HIGHER_PRC * nb_powers / 100. + 0.5;
-                    for (i = HIST_SIZE - 1; i >= 0; i--) {
-                        n -= ebur128->i3000.histogram[i].count;
-                        if (n < nb_pow) {
-                            ebur128->lra_high = ebur128->i3000.histogram[i].loudness;
-                            break;
-                        }
-                    }
-
-                    // XXX: show low & high on the graph?
-                    ebur128->loudness_range = ebur128->lra_high - ebur128->lra_low;
-                }
+                gate_update(&ebur128->i3000, power_3000, loudness_3000, LRA_GATE_THRES);
+                if (ebur128->need_results)
+                    update_loudness_range(ebur128);
             }
 
             /* dual-mono correction */
@@ -868,6 +981,13 @@ static av_cold void uninit(AVFilterContext *ctx)
     int i;
     EBUR128Context *ebur128 = ctx->priv;
 
+    if (!ebur128->need_results) {
+        if (ebur128->i400.nb_kept_powers)
+            update_integrated_loudness(ebur128);
+        if (ebur128->i3000.nb_kept_powers)
+            update_loudness_range(ebur128);
+    }
+
     /* dual-mono correction */
     if (ebur128->nb_channels == 1 && ebur128->dual_mono) {
         ebur128->i400.rel_threshold -= ebur128->pan_law;
@@ -920,10 +1040,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     for (i = 0; i < ctx->nb_outputs; i++)
         av_freep(&ctx->output_pads[i].name);
     av_frame_free(&ebur128->outpicref);
-#if CONFIG_SWRESAMPLE
-    av_freep(&ebur128->swr_buf);
-    swr_free(&ebur128->swr_ctx);
-#endif
+    av_freep(&ebur128->tp_buf);
 }
 
 static const AVFilterPad ebur128_inputs[] = {
@@ -946,5 +1063,5 @@ AVFilter ff_af_ebur128 = {
     .inputs        = ebur128_inputs,
     .outputs       = NULL,
     .priv_class    = &ebur128_class,
-    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS,
+    .flags         = AVFILTER_FLAG_DYNAMIC_OUTPUTS | AVFILTER_FLAG_SLICE_THREADS,
 };
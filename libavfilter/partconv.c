@@ -0,0 +1,214 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Partitioned overlap-save FFT convolution
+ *
+ * The partitions are grouped in levels. All the partitions of a level have
+ * the same size N; they are convolved with the input using FFTs of size 2N,
+ * and a frequency-domain delay line holding the spectra of the last input
+ * blocks, so that a level costs one FFT and one inverse FFT per N input
+ * samples whatever its number of partitions.
+ *
+ * A level only gets a complete input block every N samples, its output is
+ * thus available N - block_size samples late. The partitions of the level
+ * are placed at least that far in the impulse response, so the output of
+ * the level is always ready before it is needed.
+ */
+
+#include "libavutil/avassert.h"
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+
+#include "partconv.h"
+
+static int level_init(PartConvLevel *l, const float *ir, int ir_len,
+                      int part_size, int nb_parts, int offset)
+{
+    int nbits = av_log2(2 * part_size);
+    int p, i;
+
+    l->part_size = part_size;
+    l->nb_parts  = nb_parts;
+    l->offset    = offset;
+
+    l->rdft  = av_rdft_init(nbits, DFT_R2C);
+    l->irdft = av_rdft_init(nbits, IDFT_C2R);
+    l->ir    = av_malloc_array(nb_parts, 2 * part_size * sizeof(*l->ir));
+    l->fdl   = av_calloc(nb_parts, 2 * part_size * sizeof(*l->fdl));
+    l->in    = av_calloc(2 * part_size, sizeof(*l->in));
+    l->sum   = av_malloc_array(2 * part_size, sizeof(*l->sum));
+    if (!l->rdft || !l->irdft || !l->ir || !l->fdl || !l->in || !l->sum)
+        return AVERROR(ENOMEM);
+
+    for (p = 0; p < nb_parts; p++) {
+        float *spec = l->ir + p * 2 * part_size;
+        int start = offset + p * part_size;
+        int len   = av_clip(ir_len - start, 0, part_size);
+
+        /* the inverse transform scales by part_size, compensate here */
+        for (i = 0; i < len; i++)
+            spec[i] = ir[start + i] / part_size;
+        memset(spec + len, 0, (2 * part_size - len) * sizeof(*spec));
+        av_rdft_calc(l->rdft, spec);
+    }
+
+    return 0;
+}
+
+int ff_partconv_init(PartConvContext *s, const float *ir, int ir_len,
+                     int min_part, int max_part)
+{
+    int offset, part_size, max_offset = 0, out_size, ret;
+
+    memset(s, 0, sizeof(*s));
+
+    if (ir_len <= 0 || min_part < PARTCONV_MIN_SIZE || max_part > PARTCONV_MAX_SIZE ||
+        min_part > max_part || min_part & (min_part - 1) || max_part & (max_part - 1))
+        return AVERROR(EINVAL);
+
+    s->block_size = min_part;
+
+    /*
+     * Each level uses partitions four times larger than the previous one,
+     * it starts when the IR offset allows for its output delay.
+     */
+    for (offset = 0, part_size = min_part; offset < ir_len; part_size = FFMIN(4 * part_size, max_part)) {
+        int next = FFMIN(4 * part_size, max_part);
+        int nb_parts = (ir_len - offset + part_size - 1) / part_size;
+        PartConvLevel *levels;
+
+        if (next > part_size)
+            nb_parts = FFMIN(nb_parts,
+                             FFMAX((next - min_part - offset + part_size - 1) / part_size, 1));
+
+        levels = av_realloc_array(s->levels, s->nb_levels + 1, sizeof(*levels));
+        if (!levels) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        s->levels = levels;
+        memset(&s->levels[s->nb_levels], 0, sizeof(*levels));
+        s->nb_levels++;
+
+        ret = level_init(&s->levels[s->nb_levels - 1], ir, ir_len,
+                         part_size, nb_parts, offset);
+        if (ret < 0)
+            goto fail;
+
+        max_offset = offset;
+        offset += nb_parts * part_size;
+    }
+
+    out_size = 1 << av_ceil_log2(max_offset + min_part);
+    s->out = av_calloc(out_size, sizeof(*s->out));
+    if (!s->out) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    s->out_mask = out_size - 1;
+
+    return 0;
+fail:
+    ff_partconv_uninit(s);
+    return ret;
+}
+
+static void cmul_add(float *sum, const float *t, const float *c, int len)
+{
+    int n;
+
+    /* DC and Nyquist are real and packed in the first two values */
+    sum[0] += t[0] * c[0];
+    sum[1] += t[1] * c[1];
+
+    for (n = 2; n < len; n += 2) {
+        const float tre = t[n], tim = t[n + 1];
+        const float cre = c[n], cim = c[n + 1];
+
+        sum[n    ] += tre * cre - tim * cim;
+        sum[n + 1] += tre * cim + tim * cre;
+    }
+}
+
+static void level_process(PartConvContext *s, PartConvLevel *l, const float *src)
+{
+    const int size = 2 * l->part_size;
+    float *spec;
+    int p, i, idx, pos;
+
+    memcpy(l->in + l->part_size + l->fill, src, s->block_size * sizeof(*src));
+    l->fill += s->block_size;
+    if (l->fill < l->part_size)
+        return;
+    l->fill = 0;
+
+    if (++l->pos == l->nb_parts)
+        l->pos = 0;
+    spec = l->fdl + l->pos * size;
+    memcpy(spec, l->in, size * sizeof(*spec));
+    memcpy(l->in, l->in + l->part_size, l->part_size * sizeof(*l->in));
+    av_rdft_calc(l->rdft, spec);
+
+    memset(l->sum, 0, size * sizeof(*l->sum));
+    for (p = 0, idx = l->pos; p < l->nb_parts; p++) {
+        cmul_add(l->sum, l->fdl + idx * size, l->ir + p * size, size);
+        if (--idx < 0)
+            idx = l->nb_parts - 1;
+    }
+    av_rdft_calc(l->irdft, l->sum);
+
+    /* the second half is the output of the input block just completed */
+    pos = s->out_pos + l->offset + s->block_size - l->part_size;
+    for (i = 0; i < l->part_size; i++)
+        s->out[(pos + i) & s->out_mask] += l->sum[l->part_size + i];
+}
+
+void ff_partconv_process(PartConvContext *s, float *dst, const float *src)
+{
+    float *out = s->out + s->out_pos;
+    int i;
+
+    for (i = 0; i < s->nb_levels; i++)
+        level_process(s, &s->levels[i], src);
+
+    av_assert2(s->out_pos + s->block_size <= s->out_mask + 1);
+    memcpy(dst, out, s->block_size * sizeof(*dst));
+    memset(out, 0, s->block_size * sizeof(*out));
+    s->out_pos = (s->out_pos + s->block_size) & s->out_mask;
+}
+
+void ff_partconv_uninit(PartConvContext *s)
+{
+    int i;
+
+    for (i = 0; i < s->nb_levels; i++) {
+        PartConvLevel *l = &s->levels[i];
+
+        av_rdft_end(l->rdft);
+        av_rdft_end(l->irdft);
+        av_freep(&l->ir);
+        av_freep(&l->fdl);
+        av_freep(&l->in);
+        av_freep(&l->sum);
+    }
+    av_freep(&s->levels);
+    av_freep(&s->out);
+    s->nb_levels = 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Partitioned overlap-save FFT convolution
+ *
+ * The impulse response is split into partitions which are convolved in the
+ * frequency domain. The first partitions have the size of one processing
+ * block, so the latency is one block whatever the length of the impulse
+ * response; later partitions grow in size to reduce the cost of the tail.
+ */
+
+#ifndef AVFILTER_PARTCONV_H
+#define AVFILTER_PARTCONV_H
+
+#include "libavcodec/avfft.h"
+
+#define PARTCONV_MIN_SIZE 8
+#define PARTCONV_MAX_SIZE 32768
+
+typedef struct PartConvLevel {
+    RDFTContext *rdft;
+    RDFTContext *irdft;
+    int part_size;      /**< partition size, the FFTs are twice as long */
+    int nb_parts;       /**< number of partitions */
+    int offset;         /**< position of the first partition in the IR */
+    int fill;           /**< number of samples in the current input block */
+    int pos;            /**< index of the newest spectrum in fdl */
+    float *ir;          /**< spectra of the IR partitions */
+    float *fdl;         /**< spectra of the last nb_parts input blocks */
+    float *in;          /**< last two input blocks */
+    float *sum;         /**< accumulated spectrum of the output block */
+} PartConvLevel;
+
+typedef struct PartConvContext {
+    int block_size;     /**< number of samples per ff_partconv_process() call */
+    int nb_levels;
+    PartConvLevel *levels;
+    float *out;         /**< ring buffer of the pending output samples */
+    int out_mask;
+    int out_pos;
+} PartConvContext;
+
+/**
+ * Initialize a convolution engine for an impulse response.
+ *
+ * @param ir       the impulse response, it is copied
+ * @param ir_len   number of samples in ir
+ * @param min_part size of the first partitions and of the processing
+ *                 blocks, must be a power of 2
+ * @param max_part maximum partition size, must be a power of 2; if it is
+ *                 equal to min_part the partitioning is uniform
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int ff_partconv_init(PartConvContext *s, const float *ir, int ir_len,
+                     int min_part, int max_part);
+
+/**
+ * Convolve one block of block_size samples.
+ *
+ * The output is the convolution of all the input passed so far with the
+ * impulse response, without delay. dst and src may be equal.
+ */
+void ff_partconv_process(PartConvContext *s, float *dst, const float *src);
+
+void ff_partconv_uninit(PartConvContext *s);
+
+#endif /* AVFILTER_PARTCONV_H */
@@ -2247,13 +2247,14 @@ static int parse_pcr(int64_t *ppcr_high, int *ppcr_low,
                      const uint8_t *packet);
 
 /* handle one TS packet */
-static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
+/* handle one TS packet, pos is the byte position just behind its
+ * TS_PACKET_SIZE bytes */
+static int handle_packet(MpegTSContext *ts, const uint8_t *packet, int64_t pos)
 {
     MpegTSFilter *tss;
     int len, pid, cc, expected_cc, cc_ok, afc, is_start, is_discontinuity,
         has_adaptation, has_payload;
     const uint8_t *p, *p_end;
-    int64_t pos;
 
     pid = AV_RB16(packet + 1) & 0x1fff;
     if (pid && discard_pid(ts, pid))
@@ -2310,7 +2311,6 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
     if (p >= p_end || !has_payload)
         return 0;
 
-    pos = avio_tell(ts->stream->pb);
     if (pos >= 0) {
         av_assert0(pos >= TS_PACKET_SIZE);
         ts->pos47_full = pos - TS_PACKET_SIZE;
@@ -2477,12 +2477,26 @@ static void finished_reading_packet(AVFormatContext *s, int raw_packet_size)
         avio_skip(pb, skip);
 }
 
+/* Return the number of consecutive raw packets starting at buf which fit
+ * before buf_end and begin with a sync byte. */
+static int count_synced_packets(const uint8_t *buf, const uint8_t *buf_end,
+                                int raw_packet_size)
+{
+    const uint8_t *p = buf;
+
+    while (buf_end - p >= raw_packet_size && p[0] == 0x47)
+        p += raw_packet_size;
+    return (p - buf) / raw_packet_size;
+}
+
 static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
 {
     AVFormatContext *s = ts->stream;
+    AVIOContext *pb = s->pb;
     uint8_t packet[TS_PACKET_SIZE + AV_INPUT_BUFFER_PADDING_SIZE];
     const uint8_t *data;
-    int64_t packet_num;
+    int64_t packet_num, pos = 0;
+    int nb_buffered = 0;
     int ret = 0;
 
     if (avio_tell(s->pb) != ts->last_pos) {
@@ -2518,10 +2532,30 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         if (ts->stop_parse > 0)
             break;
 
+        /* Fast path: consume packets which are already in the I/O buffer
+         * and were checked for sync in one pass, without going through
+         * the generic read, tell and skip functions for each of them. */
+        if (!nb_buffered && !pb->write_flag) {
+            nb_buffered = count_synced_packets(pb->buf_ptr, pb->buf_end,
+                                               ts->raw_packet_size);
+            if (nb_buffered)
+                pos = avio_tell(pb);
+        }
+        if (nb_buffered) {
+            data = pb->buf_ptr;
+            pb->buf_ptr += ts->raw_packet_size;
+            pos         += ts->raw_packet_size;
+            nb_buffered--;
+            ret = handle_packet(ts, data, pos - ts->raw_packet_size + TS_PACKET_SIZE);
+            if (ret != 0)
+                break;
+            continue;
+        }
+
         ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             break;
-        ret = handle_packet(ts, data);
+        ret = handle_packet(ts, data, avio_tell(pb));
         finished_reading_packet(s, ts->raw_packet_size);
         if (ret != 0)
             break;
@@ -2916,7 +2950,7 @@ int avpriv_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
             buf++;
             len--;
         } else {
-            handle_packet(ts, buf);
+            handle_packet(ts, buf, avio_tell(ts->stream->pb));
             buf += TS_PACKET_SIZE;
             len -= TS_PACKET_SIZE;
             if (ts->stop_parse == 1)
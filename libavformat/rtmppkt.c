@@ -20,6 +20,7 @@
  */
 
 #include "libavcodec/bytestream.h"
+#include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/intfloat.h"
 #include "avformat.h"
@@ -314,11 +315,11 @@ int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
                          int chunk_size, RTMPPacket **prev_pkt_ptr,
                          int *nb_prev_pkt)
 {
-    uint8_t pkt_hdr[16], *p = pkt_hdr;
+    uint8_t pkt_hdr[16], *p = pkt_hdr, *buf, *q;
     int mode = RTMP_PS_TWELVEBYTES;
     int off = 0;
     int written = 0;
-    int ret;
+    int ret, nb_chunks, cont_hdr_size;
     RTMPPacket *prev_pkt;
     int use_delta; // flag if using timestamp delta, not RTMP_PS_TWELVEBYTES
     uint32_t timestamp; // full 32-bit timestamp or delta value
@@ -382,28 +383,34 @@ int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
     prev_pkt[pkt->channel_id].ts_field   = pkt->ts_field;
     prev_pkt[pkt->channel_id].extra      = pkt->extra;
 
-    if ((ret = ffurl_write(h, pkt_hdr, p - pkt_hdr)) < 0)
-        return ret;
-    written = p - pkt_hdr + pkt->size;
+    /* Assemble all chunks of the packet and send them with a single
+     * write, instead of one write per header and chunk. */
+    nb_chunks     = pkt->size ? (pkt->size + chunk_size - 1) / chunk_size : 1;
+    cont_hdr_size = 1 + (pkt->ts_field == 0xFFFFFF ? 4 : 0);
+    written       = p - pkt_hdr + pkt->size + (nb_chunks - 1) * cont_hdr_size;
+
+    buf = av_malloc(written);
+    if (!buf)
+        return AVERROR(ENOMEM);
+
+    q = buf;
+    bytestream_put_buffer(&q, pkt_hdr, p - pkt_hdr);
     while (off < pkt->size) {
         int towrite = FFMIN(chunk_size, pkt->size - off);
-        if ((ret = ffurl_write(h, pkt->data + off, towrite)) < 0)
-            return ret;
+        bytestream_put_buffer(&q, pkt->data + off, towrite);
         off += towrite;
         if (off < pkt->size) {
-            uint8_t marker = 0xC0 | pkt->channel_id;
-            if ((ret = ffurl_write(h, &marker, 1)) < 0)
-                return ret;
-            written++;
-            if (pkt->ts_field == 0xFFFFFF) {
-                uint8_t ts_header[4];
-                AV_WB32(ts_header, timestamp);
-                if ((ret = ffurl_write(h, ts_header, 4)) < 0)
-                    return ret;
-                written += 4;
-            }
+            bytestream_put_byte(&q, 0xC0 | pkt->channel_id);
+            if (pkt->ts_field == 0xFFFFFF)
+                bytestream_put_be32(&q, timestamp);
         }
     }
+    av_assert1(q - buf == written);
+
+    ret = ffurl_write(h, buf, written);
+    av_free(buf);
+    if (ret < 0)
+        return ret;
     return written;
 }
 
@@ -123,6 +123,7 @@ typedef struct RTMPContext {
     int           tracked_methods_size;       ///< size of the tracked methods buffer
     int           listen;                     ///< listen mode flag
     int           listen_timeout;             ///< listen timeout to wait for new connections
+    int           chunk_size;                 ///< outgoing chunk size to announce, 0 to mirror the server's
     int           nb_streamid;                ///< The next stream id to return on createStream calls
     double        duration;                   ///< Duration of the stream in seconds as returned by the server (only valid if non-zero)
     char          username[50];
@@ -313,6 +314,33 @@ fail:
     return AVERROR(EINVAL);
 }
 
+/**
+ * Generate 'Set Chunk Size' message and switch to the new outgoing
+ * chunk size.
+ */
+static int gen_chunk_size(URLContext *s, RTMPContext *rt, int chunk_size)
+{
+    RTMPPacket pkt;
+    uint8_t *p;
+    int ret;
+
+    if ((ret = ff_rtmp_packet_create(&pkt, RTMP_SYSTEM_CHANNEL,
+                                     RTMP_PT_CHUNK_SIZE, 0, 4)) < 0)
+        return ret;
+
+    p = pkt.data;
+    bytestream_put_be32(&p, chunk_size);
+    ret = ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size,
+                               &rt->prev_pkt[1], &rt->nb_prev_pkt[1]);
+    ff_rtmp_packet_destroy(&pkt);
+    if (ret < 0)
+        return ret;
+
+    rt->out_chunk_size = chunk_size;
+    av_log(s, AV_LOG_DEBUG, "New outgoing chunk size = %d\n", chunk_size);
+    return 0;
+}
+
 /**
  * Generate 'connect' call and send it to the server.
  */
@@ -521,16 +549,8 @@ static int read_connect(URLContext *s, RTMPContext *rt)
         return ret;
 
     // Chunk size
-    if ((ret = ff_rtmp_packet_create(&pkt, RTMP_SYSTEM_CHANNEL,
-                                     RTMP_PT_CHUNK_SIZE, 0, 4)) < 0)
-        return ret;
-
-    p = pkt.data;
-    bytestream_put_be32(&p, rt->out_chunk_size);
-    ret = ff_rtmp_packet_write(rt->stream, &pkt, rt->out_chunk_size,
-                               &rt->prev_pkt[1], &rt->nb_prev_pkt[1]);
-    ff_rtmp_packet_destroy(&pkt);
-    if (ret < 0)
+    if ((ret = gen_chunk_size(s, rt, rt->chunk_size ? rt->chunk_size
+                                                    : rt->out_chunk_size)) < 0)
         return ret;
 
     // Send _result NetConnection.Connect.Success to connect
@@ -1528,7 +1548,7 @@ static int handle_chunk_size(URLContext *s, RTMPPacket *pkt)
         return AVERROR_INVALIDDATA;
     }
 
-    if (!rt->is_input) {
+    if (!rt->is_input && !rt->chunk_size) {
         /* Send the same chunk size change packet back to the server,
          * setting the outgoing chunk size to the same as the incoming one. */
         if ((ret = ff_rtmp_packet_write(rt->stream, pkt, rt->out_chunk_size,
@@ -2668,12 +2688,15 @@ static int rtmp_open(URLContext *s, const char *uri, int flags)
         /* open the tcp connection */
         if (port < 0)
             port = RTMP_DEFAULT_PORT;
+        /* each message is sent with a single write, so there is nothing
+         * to gain from Nagle's algorithm but latency */
         if (rt->listen)
             ff_url_join(buf, sizeof(buf), "tcp", NULL, hostname, port,
-                        "?listen&listen_timeout=%d",
+                        "?listen&listen_timeout=%d&tcp_nodelay=1",
                         rt->listen_timeout * 1000);
         else
-            ff_url_join(buf, sizeof(buf), "tcp", NULL, hostname, port, NULL);
+            ff_url_join(buf, sizeof(buf), "tcp", NULL, hostname, port,
+                        "?tcp_nodelay=1");
     }
 
 reconnect:
@@ -2823,6 +2846,9 @@ reconnect:
     av_log(s, AV_LOG_DEBUG, "Proto = %s, path = %s, app = %s, fname = %s\n",
            proto, path, rt->app, rt->playpath);
     if (!rt->listen) {
+        if (!rt->is_input && rt->chunk_size &&
+            (ret = gen_chunk_size(s, rt, rt->chunk_size)) < 0)
+            goto fail;
         if ((ret = gen_connect(s, rt)) < 0)
             goto fail;
     } else {
@@ -3110,6 +3136,7 @@ static int rtmp_write(URLContext *s, const uint8_t *buf, int size)
 static const AVOption rtmp_options[] = {
     {"rtmp_app", "Name of application to connect to on the RTMP server", OFFSET(app), AV_OPT_TYPE_STRING, {.str = NULL }, 0, 0, DEC|ENC},
     {"rtmp_buffer", "Set buffer time in milliseconds. The default is 3000.", OFFSET(client_buffer_time), AV_OPT_TYPE_INT, {.i64 = 3000}, 0, INT_MAX, DEC|ENC},
+    {"rtmp_chunk_size", "Size of the chunks outgoing packets are split into. 0 mirrors the server's chunk size.", OFFSET(chunk_size), AV_OPT_TYPE_INT, {.i64 = 4096}, 0, 0xFFFFFF, DEC|ENC},
     {"rtmp_conn", "Append arbitrary AMF data to the Connect message", OFFSET(conn), AV_OPT_TYPE_STRING, {.str = NULL }, 0, 0, DEC|ENC},
     {"rtmp_flashver", "Version of the Flash plugin used to run the SWF player.", OFFSET(flashver), AV_OPT_TYPE_STRING, {.str = NULL }, 0, 0, DEC|ENC},
     {"rtmp_flush_interval", "Number of packets flushed in the same request (RTMPT only).", OFFSET(flush_interval), AV_OPT_TYPE_INT, {.i64 = 10}, 0, INT_MAX, ENC},
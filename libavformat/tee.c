@@ -23,6 +23,8 @@
 #include "libavutil/avutil.h"
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
+#include "libavutil/threadmessage.h"
 #include "internal.h"
 #include "avformat.h"
 #include "avio_internal.h"
@@ -35,6 +37,16 @@ typedef enum {
 
 #define DEFAULT_SLAVE_FAILURE_POLICY ON_SLAVE_FAILURE_ABORT
 
+typedef enum {
+    ON_QUEUE_FULL_BLOCK = 1,
+    ON_QUEUE_FULL_DROP  = 2
+} QueueFullPolicy;
+
+typedef struct {
+    AVPacket pkt;
+    int flush; ///< flush the slave instead of writing pkt
+} TeeMessage;
+
 typedef struct {
     AVFormatContext *avf;
     AVBSFContext **bsfs; ///< bitstream filters per stream
@@ -45,6 +57,21 @@ typedef struct {
      * disabled output streams are set to -1 */
     int *stream_map;
     int header_written;
+
+    /** if queue_size is set, packets are written by a dedicated thread
+     * reading them from a queue of that many packets */
+    int queue_size;
+    QueueFullPolicy on_full;
+    AVThreadMessageQueue *queue;
+#if HAVE_THREADS
+    pthread_t thread;
+#endif
+    int thread_started;
+    int thread_ret; ///< error which stopped the thread, if any
+    /** per output stream, set after packets were dropped on a full
+     * queue; packets are then dropped until the next keyframe */
+    uint8_t *drop_until_keyframe;
+    void *log_ctx; ///< tee muxer context, used for logging from the thread
 } TeeSlave;
 
 typedef struct TeeContext {
@@ -81,6 +108,43 @@ static inline int parse_slave_failure_policy_option(const char *opt, TeeSlave *t
     return AVERROR(EINVAL);
 }
 
+static inline int parse_queue_full_policy_option(const char *opt, TeeSlave *tee_slave)
+{
+    if (!opt || !av_strcasecmp("block", opt)) {
+        tee_slave->on_full = ON_QUEUE_FULL_BLOCK;
+        return 0;
+    } else if (!av_strcasecmp("drop", opt)) {
+        tee_slave->on_full = ON_QUEUE_FULL_DROP;
+        return 0;
+    }
+    return AVERROR(EINVAL);
+}
+
+static void free_message(void *msg)
+{
+    TeeMessage *tee_msg = msg;
+    av_packet_unref(&tee_msg->pkt);
+}
+
+static int stop_slave_thread(TeeSlave *tee_slave)
+{
+#if HAVE_THREADS
+    int ret;
+
+    if (tee_slave->thread_started) {
+        /* let the thread write everything queued so far, then exit */
+        av_thread_message_queue_set_err_recv(tee_slave->queue, AVERROR_EOF);
+        ret = pthread_join(tee_slave->thread, NULL);
+        if (ret)
+            av_log(tee_slave->log_ctx, AV_LOG_ERROR, "pthread_join(): %s\n",
+                   av_err2str(AVERROR(ret)));
+        tee_slave->thread_started = 0;
+    }
+#endif
+    av_thread_message_queue_free(&tee_slave->queue);
+    return tee_slave->thread_ret;
+}
+
 static int close_slave(TeeSlave *tee_slave)
 {
     AVFormatContext *avf;
@@ -91,8 +155,13 @@ static int close_slave(TeeSlave *tee_slave)
     if (!avf)
         return 0;
 
-    if (tee_slave->header_written)
-        ret = av_write_trailer(avf);
+    ret = stop_slave_thread(tee_slave);
+
+    if (tee_slave->header_written) {
+        int trailer_ret = av_write_trailer(avf);
+        if (!ret)
+            ret = trailer_ret;
+    }
 
     if (tee_slave->bsfs) {
         for (i = 0; i < avf->nb_streams; ++i)
@@ -100,6 +169,7 @@ static int close_slave(TeeSlave *tee_slave)
     }
     av_freep(&tee_slave->stream_map);
     av_freep(&tee_slave->bsfs);
+    av_freep(&tee_slave->drop_until_keyframe);
 
     ff_format_io_close(avf, &avf->pb);
     avformat_free_context(avf);
@@ -118,6 +188,139 @@ static void close_slaves(AVFormatContext *avf)
     av_freep(&tee->slaves);
 }
 
+/* Send pkt through the slave bitstream filters and write the result,
+ * pkt->stream_index must already be mapped to the slave stream.
+ * pkt is consumed; if NULL, the slave is flushed. */
+static int tee_write_slave_packet(void *log_ctx, TeeSlave *tee_slave, AVPacket *pkt)
+{
+    AVFormatContext *avf2 = tee_slave->avf;
+    AVBSFContext *bsfs;
+    int ret, s2;
+
+    if (!pkt)
+        return av_interleaved_write_frame(avf2, NULL);
+
+    s2   = pkt->stream_index;
+    bsfs = tee_slave->bsfs[s2];
+
+    ret = av_bsf_send_packet(bsfs, pkt);
+    if (ret < 0) {
+        av_log(log_ctx, AV_LOG_ERROR, "Error while sending packet to bitstream filter: %s\n",
+               av_err2str(ret));
+        av_packet_unref(pkt);
+        return ret;
+    }
+
+    while(1) {
+        ret = av_bsf_receive_packet(bsfs, pkt);
+        if (ret == AVERROR(EAGAIN))
+            return 0;
+        else if (ret < 0)
+            return ret;
+
+        av_packet_rescale_ts(pkt, bsfs->time_base_out,
+                             avf2->streams[s2]->time_base);
+        ret = av_interleaved_write_frame(avf2, pkt);
+        if (ret < 0)
+            return ret;
+    }
+}
+
+#if HAVE_THREADS
+static void *tee_slave_thread(void *arg)
+{
+    TeeSlave *tee_slave = arg;
+    TeeMessage msg;
+    int ret;
+
+    while (1) {
+        ret = av_thread_message_queue_recv(tee_slave->queue, &msg, 0);
+        if (ret < 0)
+            break;
+        ret = tee_write_slave_packet(tee_slave->log_ctx, tee_slave,
+                                     msg.flush ? NULL : &msg.pkt);
+        av_packet_unref(&msg.pkt);
+        if (ret < 0)
+            break;
+    }
+
+    tee_slave->thread_ret = ret == AVERROR_EOF ? 0 : ret;
+    /* make the muxer thread see the failure on its next send */
+    av_thread_message_queue_set_err_send(tee_slave->queue,
+                                         ret < 0 ? ret : AVERROR_EOF);
+    return NULL;
+}
+#endif
+
+static int start_slave_thread(AVFormatContext *avf, TeeSlave *tee_slave)
+{
+#if HAVE_THREADS
+    int ret;
+
+    tee_slave->log_ctx = avf;
+    tee_slave->drop_until_keyframe = av_mallocz(tee_slave->avf->nb_streams);
+    if (!tee_slave->drop_until_keyframe)
+        return AVERROR(ENOMEM);
+
+    ret = av_thread_message_queue_alloc(&tee_slave->queue, tee_slave->queue_size,
+                                        sizeof(TeeMessage));
+    if (ret < 0)
+        return ret;
+    av_thread_message_queue_set_free_func(tee_slave->queue, free_message);
+
+    ret = pthread_create(&tee_slave->thread, NULL, tee_slave_thread, tee_slave);
+    if (ret) {
+        av_log(avf, AV_LOG_ERROR, "Failed to start slave thread: %s\n",
+               av_err2str(AVERROR(ret)));
+        return AVERROR(ret);
+    }
+    tee_slave->thread_started = 1;
+    return 0;
+#else
+    av_log(avf, AV_LOG_ERROR, "Slave queues require a build with thread support\n");
+    return AVERROR(ENOSYS);
+#endif
+}
+
+/* Hand pkt over to the slave thread, pkt is consumed; if NULL, a flush
+ * of the slave is queued. */
+static int tee_queue_slave_packet(void *log_ctx, TeeSlave *tee_slave, AVPacket *pkt)
+{
+    TeeMessage msg = { { 0 } };
+    unsigned flags = tee_slave->on_full == ON_QUEUE_FULL_DROP ?
+                     AV_THREAD_MESSAGE_NONBLOCK : 0;
+    int ret;
+
+    if (!pkt) {
+        msg.flush = 1;
+        ret = av_thread_message_queue_send(tee_slave->queue, &msg, flags);
+        return ret == AVERROR(EAGAIN) ? 0 : ret;
+    }
+
+    if (tee_slave->drop_until_keyframe[pkt->stream_index]) {
+        if (!(pkt->flags & AV_PKT_FLAG_KEY)) {
+            av_packet_unref(pkt);
+            return 0;
+        }
+        tee_slave->drop_until_keyframe[pkt->stream_index] = 0;
+    }
+
+    /* the packet data is shared with the other slaves, only the
+     * reference is moved into the queue */
+    msg.pkt = *pkt;
+    ret = av_thread_message_queue_send(tee_slave->queue, &msg, flags);
+    if (ret < 0) {
+        av_packet_unref(pkt);
+        if (ret == AVERROR(EAGAIN)) {
+            av_log(log_ctx, AV_LOG_WARNING, "Slave '%s': queue full, dropping "
+                   "packets until the next keyframe\n", tee_slave->avf->filename);
+            memset(tee_slave->drop_until_keyframe, 1, tee_slave->avf->nb_streams);
+            ret = 0;
+        }
+    }
+    return ret;
+}
+
 static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
 {
     int i, ret;
@@ -125,6 +328,7 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
     AVDictionaryEntry *entry;
     char *filename;
     char *format = NULL, *select = NULL, *on_fail = NULL;
+    char *queue_size = NULL, *on_full = NULL;
     AVFormatContext *avf2 = NULL;
     AVStream *st, *st2;
     int stream_count;
@@ -145,6 +349,8 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
     STEAL_OPTION("f", format);
     STEAL_OPTION("select", select);
     STEAL_OPTION("onfail", on_fail);
+    STEAL_OPTION("queue_size", queue_size);
+    STEAL_OPTION("onfull", on_full);
 
     ret = parse_slave_failure_policy_option(on_fail, tee_slave);
     if (ret < 0) {
@@ -153,6 +359,24 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
         goto end;
     }
 
+    ret = parse_queue_full_policy_option(on_full, tee_slave);
+    if (ret < 0) {
+        av_log(avf, AV_LOG_ERROR,
+               "Invalid onfull option value, valid options are 'block' and 'drop'\n");
+        goto end;
+    }
+
+    if (queue_size) {
+        char *endptr;
+        tee_slave->queue_size = strtol(queue_size, &endptr, 10);
+        if (*endptr || tee_slave->queue_size < 0) {
+            av_log(avf, AV_LOG_ERROR,
+                   "Invalid queue_size option value '%s'\n", queue_size);
+            ret = AVERROR(EINVAL);
+            goto end;
+        }
+    }
+
     ret = avformat_alloc_output_context2(&avf2, NULL, format, filename);
     if (ret < 0)
         goto end;
@@ -320,10 +544,15 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
         goto end;
     }
 
+    if (tee_slave->queue_size > 0)
+        ret = start_slave_thread(avf, tee_slave);
+
 end:
     av_free(format);
     av_free(select);
     av_free(on_fail);
+    av_free(queue_size);
+    av_free(on_full);
     av_dict_free(&options);
     av_freep(&tmp_select);
     return ret;
@@ -451,20 +680,21 @@ static int tee_write_trailer(AVFormatContext *avf)
 static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
 {
     TeeContext *tee = avf->priv_data;
-    AVFormatContext *avf2;
-    AVBSFContext *bsfs;
+    TeeSlave *tee_slave;
     AVPacket pkt2;
     int ret_all = 0, ret;
     unsigned i, s;
     int s2;
 
     for (i = 0; i < tee->nb_slaves; i++) {
-        if (!(avf2 = tee->slaves[i].avf))
+        tee_slave = &tee->slaves[i];
+        if (!tee_slave->avf)
             continue;
 
         /* Flush slave if pkt is NULL*/
         if (!pkt) {
-            ret = av_interleaved_write_frame(avf2, NULL);
+            ret = tee_slave->queue ? tee_queue_slave_packet(avf, tee_slave, NULL) :
+                                     tee_write_slave_packet(avf, tee_slave, NULL);
             if (ret < 0) {
                 ret = tee_process_slave_failure(avf, i, ret);
                 if (!ret_all && ret < 0)
@@ -474,7 +704,7 @@ static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
         }
 
         s = pkt->stream_index;
-        s2 = tee->slaves[i].stream_map[s];
+        s2 = tee_slave->stream_map[s];
         if (s2 < 0)
             continue;
 
@@ -484,34 +714,10 @@ static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
                 ret_all = ret;
                 continue;
             }
-        bsfs = tee->slaves[i].bsfs[s2];
         pkt2.stream_index = s2;
 
-        ret = av_bsf_send_packet(bsfs, &pkt2);
-        if (ret < 0) {
-            av_log(avf, AV_LOG_ERROR, "Error while sending packet to bitstream filter: %s\n",
-                   av_err2str(ret));
-            ret = tee_process_slave_failure(avf, i, ret);
-            if (!ret_all && ret < 0)
-                ret_all = ret;
-        }
-
-        while(1) {
-            ret = av_bsf_receive_packet(bsfs, &pkt2);
-            if (ret == AVERROR(EAGAIN)) {
-                ret = 0;
-                break;
-            } else if (ret < 0) {
-                break;
-            }
-
-            av_packet_rescale_ts(&pkt2, bsfs->time_base_out,
-                                 avf2->streams[s2]->time_base);
-            ret = av_interleaved_write_frame(avf2, &pkt2);
-            if (ret < 0)
-                break;
-        };
-
+        ret = tee_slave->queue ? tee_queue_slave_packet(avf, tee_slave, &pkt2) :
+                                 tee_write_slave_packet(avf, tee_slave, &pkt2);
         if (ret < 0) {
             ret = tee_process_slave_failure(avf, i, ret);
             if (!ret_all && ret < 0)
@@ -26,6 +26,7 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg()/sendmmsg() with glibc */
 
 #include "avformat.h"
 #include "avio_internal.h"
@@ -76,6 +77,7 @@
 #define UDP_TX_BUF_SIZE 32768
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
+#define UDP_MAX_BATCH 1024
 
 typedef struct UDPContext {
     const AVClass *class;
@@ -105,6 +107,15 @@ typedef struct UDPContext {
     pthread_mutex_t mutex;
     pthread_cond_t cond;
     int thread_started;
+#endif
+    int recv_batch;
+    int send_batch;
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    /* datagram slots for the receiving or sending thread */
+    int batch_slot_size;
+    uint8_t *batch_buf;
+    struct iovec *batch_iov;
+    struct mmsghdr *batch_msgs;
 #endif
     uint8_t tmp[UDP_MAX_PKT_SIZE+4];
     int remaining_in_dg;
@@ -133,6 +144,8 @@ static const AVOption options[] = {
     { "ttl",            "Time to live (multicast only)",                   OFFSET(ttl),            AV_OPT_TYPE_INT,    { .i64 = 16 },     0, INT_MAX, E },
     { "connect",        "set if connect() should be called on socket",     OFFSET(is_connected),   AV_OPT_TYPE_BOOL,   { .i64 =  0 },     0, 1,       .flags = D|E },
     { "fifo_size",      "set the UDP receiving circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D },
+    { "recv_batch",     "set the number of datagrams read per system call by the receiving thread", OFFSET(recv_batch), AV_OPT_TYPE_INT, {.i64 = 1}, 1, UDP_MAX_BATCH, D },
+    { "send_batch",     "set the number of datagrams written per system call by the sending thread", OFFSET(send_batch), AV_OPT_TYPE_INT, {.i64 = 1}, 1, UDP_MAX_BATCH, E },
     { "overrun_nonfatal", "survive in case of UDP receiving circular buffer overrun", OFFSET(overrun_nonfatal), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1,    D },
     { "timeout",        "set raise error timeout (only in read mode)",     OFFSET(timeout),        AV_OPT_TYPE_INT,    { .i64 = 0 },      0, INT_MAX, D },
     { "sources",        "Source list",                                     OFFSET(sources),        AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
@@ -496,6 +509,31 @@ static int udp_get_file_handle(URLContext *h)
 }
 
 #if HAVE_PTHREAD_CANCEL
+/* Append one length-prefixed datagram to the fifo, the mutex must be held.
+ * Returns 0 on success, 1 if the datagram was dropped, <0 on fatal overrun. */
+static int circular_buffer_store(URLContext *h, uint8_t *dg, int len)
+{
+    UDPContext *s = h->priv_data;
+
+    AV_WL32(dg, len);
+
+    if(av_fifo_space(s->fifo) < len + 4) {
+        /* No Space left */
+        if (s->overrun_nonfatal) {
+            av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                    "Surviving due to overrun_nonfatal option\n");
+            return 1;
+        } else {
+            av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                    "To avoid, increase fifo_size URL option. "
+                    "To survive in such case, use overrun_nonfatal option\n");
+            return AVERROR(EIO);
+        }
+    }
+    av_fifo_generic_write(s->fifo, dg, len+4, NULL);
+    return 0;
+}
+
 static void *circular_buffer_task_rx( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -510,13 +548,20 @@ static void *circular_buffer_task_rx( void *_URLContext)
         goto end;
     }
     while(1) {
-        int len;
+        int len, ret, stored = 0;
 
         pthread_mutex_unlock(&s->mutex);
         /* Blocking operations are always cancellation points;
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
+#if HAVE_RECVMMSG
+        /* Wait for the first datagram only, then take whatever else is
+         * already queued on the socket without blocking. */
+        if (s->batch_msgs)
+            len = recvmmsg(s->udp_fd, s->batch_msgs, s->recv_batch, MSG_WAITFORONE, NULL);
+        else
+#endif
         len = recv(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
         pthread_mutex_lock(&s->mutex);
@@ -527,24 +572,37 @@ static void *circular_buffer_task_rx( void *_URLContext)
             }
             continue;
         }
-        AV_WL32(s->tmp, len);
-
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
-                continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
+
+#if HAVE_RECVMMSG
+        if (s->batch_msgs) {
+            int i;
+            for (i = 0; i < len; i++) {
+                struct mmsghdr *msg = &s->batch_msgs[i];
+                uint8_t *dg = (uint8_t *)msg->msg_hdr.msg_iov->iov_base - 4;
+
+                if (msg->msg_hdr.msg_flags & MSG_TRUNC)
+                    av_log(h, AV_LOG_WARNING, "Datagram truncated to %d bytes, "
+                           "increase pkt_size\n", s->pkt_size);
+                ret = circular_buffer_store(h, dg, msg->msg_len);
+                if (ret < 0) {
+                    s->circular_buffer_error = ret;
+                    goto end;
+                }
+                stored |= !ret;
+            }
+        } else
+#endif
+        {
+            ret = circular_buffer_store(h, s->tmp, len);
+            if (ret < 0) {
+                s->circular_buffer_error = ret;
                 goto end;
             }
+            stored = !ret;
         }
-        av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
-        pthread_cond_signal(&s->cond);
+        /* one wakeup per batch rather than per datagram */
+        if (stored)
+            pthread_cond_signal(&s->cond);
     }
 
 end:
@@ -553,6 +611,33 @@ end:
     return NULL;
 }
 
+#if HAVE_SENDMMSG
+/* Send the first nb_msgs prepared batch slots, the mutex must not be held. */
+static int udp_send_batch(UDPContext *s, int nb_msgs)
+{
+    struct mmsghdr *msgs = s->batch_msgs;
+    int i;
+
+    for (i = 0; i < nb_msgs; i++) {
+        msgs[i].msg_hdr.msg_name    = s->is_connected ? NULL : &s->dest_addr;
+        msgs[i].msg_hdr.msg_namelen = s->is_connected ? 0    : s->dest_addr_len;
+    }
+
+    while (nb_msgs) {
+        int ret = sendmmsg(s->udp_fd, msgs, nb_msgs, 0);
+        if (ret >= 0) {
+            msgs    += ret;
+            nb_msgs -= ret;
+        } else {
+            ret = ff_neterrno();
+            if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR))
+                return ret;
+        }
+    }
+    return 0;
+}
+#endif
+
 static void *circular_buffer_task_tx( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -578,6 +663,9 @@ static void *circular_buffer_task_tx( void *_URLContext)
         const uint8_t *p;
         uint8_t tmp[4];
         int64_t timestamp;
+#if HAVE_SENDMMSG
+        int nb_msgs = 0;
+#endif
 
         len=av_fifo_size(s->fifo);
 
@@ -590,13 +678,37 @@ static void *circular_buffer_task_tx( void *_URLContext)
             len=av_fifo_size(s->fifo);
         }
 
-        av_fifo_generic_read(s->fifo, tmp, 4, NULL);
-        len=AV_RL32(tmp);
+#if HAVE_SENDMMSG
+        if (s->batch_msgs) {
+            /* Take every datagram already queued, up to send_batch; when
+             * pacing, a batch is one burst and may not exceed burst_bits. */
+            len = 0;
+            do {
+                uint8_t *dg = s->batch_buf + nb_msgs * s->batch_slot_size;
+                int size;
+
+                av_fifo_generic_peek(s->fifo, tmp, 4, NULL);
+                size = AV_RL32(tmp);
+                if (nb_msgs && s->bitrate &&
+                    (int64_t)(len + size) * 8 > s->burst_bits)
+                    break;
+                av_assert0(size >= 0);
+                av_assert0(size + 4 <= s->batch_slot_size);
+                av_fifo_generic_read(s->fifo, dg, size + 4, NULL);
+                s->batch_iov[nb_msgs++].iov_len = size;
+                len += size;
+            } while (nb_msgs < s->send_batch && av_fifo_size(s->fifo) >= 4);
+        } else
+#endif
+        {
+            av_fifo_generic_read(s->fifo, tmp, 4, NULL);
+            len=AV_RL32(tmp);
 
-        av_assert0(len >= 0);
-        av_assert0(len <= sizeof(s->tmp));
+            av_assert0(len >= 0);
+            av_assert0(len <= sizeof(s->tmp));
 
-        av_fifo_generic_read(s->fifo, s->tmp, len, NULL);
+            av_fifo_generic_read(s->fifo, s->tmp, len, NULL);
+        }
 
         pthread_mutex_unlock(&s->mutex);
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
@@ -621,6 +733,19 @@ static void *circular_buffer_task_tx( void *_URLContext)
             target_timestamp = start_timestamp + sent_bits * 1000000 / s->bitrate;
         }
 
+#if HAVE_SENDMMSG
+        if (nb_msgs) {
+            int ret = udp_send_batch(s, nb_msgs);
+            if (ret < 0) {
+                pthread_mutex_lock(&s->mutex);
+                s->circular_buffer_error = ret;
+                pthread_mutex_unlock(&s->mutex);
+                return NULL;
+            }
+            len = 0;
+        }
+#endif
+
         p = s->tmp;
         while (len) {
             int ret;
@@ -763,6 +888,20 @@ static int udp_open(URLContext *h, const char *uri, int flags)
                        "'circular_buffer_size' option was set but it is not supported "
                        "on this build (pthread support is required)\n");
         }
+        if (av_find_info_tag(buf, sizeof(buf), "recv_batch", p)) {
+            s->recv_batch = av_clip(strtol(buf, NULL, 10), 1, UDP_MAX_BATCH);
+            if (!HAVE_RECVMMSG)
+                av_log(h, AV_LOG_WARNING,
+                       "'recv_batch' option was set but it is not supported "
+                       "on this build (recvmmsg support is required)\n");
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "send_batch", p)) {
+            s->send_batch = av_clip(strtol(buf, NULL, 10), 1, UDP_MAX_BATCH);
+            if (!HAVE_SENDMMSG || !HAVE_PTHREAD_CANCEL)
+                av_log(h, AV_LOG_WARNING,
+                       "'send_batch' option was set but it is not supported "
+                       "on this build (sendmmsg and pthread support is required)\n");
+        }
         if (av_find_info_tag(buf, sizeof(buf), "bitrate", p)) {
             s->bitrate = strtoll(buf, NULL, 10);
             if (!HAVE_PTHREAD_CANCEL)
@@ -956,6 +1095,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
       Create thread in case of:
       1. Input and circular_buffer_size is set
       2. Output and bitrate and circular_buffer_size is set
+      3. Output and send_batch and circular_buffer_size is set
     */
 
     if (is_output && s->bitrate && !s->circular_buffer_size) {
@@ -963,11 +1103,32 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         av_log(h, AV_LOG_WARNING,"'bitrate' option was set but 'circular_buffer_size' is not, but required\n");
     }
 
-    if ((!is_output && s->circular_buffer_size) || (is_output && s->bitrate && s->circular_buffer_size)) {
+    if ((!is_output && s->circular_buffer_size) ||
+        (is_output && (s->bitrate || (HAVE_SENDMMSG && s->send_batch > 1)) && s->circular_buffer_size)) {
         int ret;
 
         /* start the task going */
         s->fifo = av_fifo_alloc(s->circular_buffer_size);
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+        if (is_output ? HAVE_SENDMMSG && s->send_batch > 1 :
+                        HAVE_RECVMMSG && s->recv_batch > 1) {
+            int nb_slots = is_output ? s->send_batch : s->recv_batch;
+
+            s->batch_slot_size = (s->pkt_size > 0 ? s->pkt_size : UDP_MAX_PKT_SIZE) + 4;
+            s->batch_buf  = av_malloc_array(nb_slots, s->batch_slot_size);
+            s->batch_iov  = av_malloc_array(nb_slots, sizeof(*s->batch_iov));
+            s->batch_msgs = av_mallocz_array(nb_slots, sizeof(*s->batch_msgs));
+            if (!s->batch_buf || !s->batch_iov || !s->batch_msgs)
+                goto fail;
+            for (i = 0; i < nb_slots; i++) {
+                /* leave room in front of each datagram for its length prefix */
+                s->batch_iov[i].iov_base = s->batch_buf + i * s->batch_slot_size + 4;
+                s->batch_iov[i].iov_len  = s->batch_slot_size - 4;
+                s->batch_msgs[i].msg_hdr.msg_iov    = &s->batch_iov[i];
+                s->batch_msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+        }
+#endif
         ret = pthread_mutex_init(&s->mutex, NULL);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
@@ -998,6 +1159,11 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_freep(&s->fifo);
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    av_freep(&s->batch_buf);
+    av_freep(&s->batch_iov);
+    av_freep(&s->batch_msgs);
+#endif
     for (i = 0; i < num_include_sources; i++)
         av_freep(&include_sources[i]);
     for (i = 0; i < num_exclude_sources; i++)
@@ -1095,6 +1261,14 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
             return err;
         }
 
+#if HAVE_SENDMMSG
+        if (s->batch_msgs && size + 4 > s->batch_slot_size) {
+            pthread_mutex_unlock(&s->mutex);
+            av_log(h, AV_LOG_ERROR, "Packet of %d bytes exceeds pkt_size, "
+                   "which is required with send_batch\n", size);
+            return AVERROR(EINVAL);
+        }
+#endif
         if(av_fifo_space(s->fifo) < size + 4) {
             /* What about a partial packet tx ? */
             pthread_mutex_unlock(&s->mutex);
@@ -1155,6 +1329,11 @@ static int udp_close(URLContext *h)
 #endif
     closesocket(s->udp_fd);
     av_fifo_freep(&s->fifo);
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    av_freep(&s->batch_buf);
+    av_freep(&s->batch_iov);
+    av_freep(&s->batch_msgs);
+#endif
     return 0;
 }
 
@@ -25,31 +25,25 @@
 #include "mem.h"
 #include "thread.h"
 
-AVBufferRef *av_buffer_create(uint8_t *data, int size,
-                              void (*free)(void *opaque, uint8_t *data),
-                              void *opaque, int flags)
+static AVBufferRef *buffer_create(AVBuffer *buf, uint8_t *data, int size,
+                                  void (*free)(void *opaque, uint8_t *data),
+                                  void *opaque, int flags)
 {
     AVBufferRef *ref = NULL;
-    AVBuffer    *buf = NULL;
-
-    buf = av_mallocz(sizeof(*buf));
-    if (!buf)
-        return NULL;
 
     buf->data     = data;
     buf->size     = size;
     buf->free     = free ? free : av_buffer_default_free;
     buf->opaque   = opaque;
     buf->refcount = 1;
+    buf->flags    = 0;
 
     if (flags & AV_BUFFER_FLAG_READONLY)
         buf->flags |= BUFFER_FLAG_READONLY;
 
     ref = av_mallocz(sizeof(*ref));
-    if (!ref) {
-        av_freep(&buf);
+    if (!ref)
         return NULL;
-    }
 
     ref->buffer = buf;
     ref->data   = data;
@@ -58,6 +52,23 @@ AVBufferRef *av_buffer_create(uint8_t *data, int size,
     return ref;
 }
 
+AVBufferRef *av_buffer_create(uint8_t *data, int size,
+                              void (*free)(void *opaque, uint8_t *data),
+                              void *opaque, int flags)
+{
+    AVBufferRef *ret;
+    AVBuffer *buf = av_mallocz(sizeof(*buf));
+    if (!buf)
+        return NULL;
+
+    ret = buffer_create(buf, data, size, free, opaque, flags);
+    if (!ret) {
+        av_free(buf);
+        return NULL;
+    }
+    return ret;
+}
+
 void av_buffer_default_free(void *opaque, uint8_t *data)
 {
     av_free(data);
@@ -116,8 +127,12 @@ static void buffer_replace(AVBufferRef **dst, AVBufferRef **src)
         av_freep(dst);
 
     if (!avpriv_atomic_int_add_and_fetch(&b->refcount, -1)) {
+        /* b->free() may already release the structure containing b,
+         * so the flag must be read before calling it */
+        int free_avbuffer = !(b->flags & BUFFER_FLAG_NO_FREE);
         b->free(b->opaque, b->data);
-        av_freep(&b);
+        if (free_avbuffer)
+            av_freep(&b);
     }
 }
 
@@ -398,19 +413,21 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
     add_to_pool(buf->next);
     buf->next = NULL;
 
-    ret = av_buffer_create(buf->data, pool->size, pool_release_buffer,
-                           buf, 0);
+    ret = buffer_create(&buf->buffer, buf->data, pool->size,
+                        pool_release_buffer, buf, 0);
     if (!ret) {
         add_to_pool(buf);
         return NULL;
     }
+    buf->buffer.flags |= BUFFER_FLAG_NO_FREE;
 #else
     ff_mutex_lock(&pool->mutex);
     buf = pool->pool;
     if (buf) {
-        ret = av_buffer_create(buf->data, pool->size, pool_release_buffer,
-                               buf, 0);
+        ret = buffer_create(&buf->buffer, buf->data, pool->size,
+                            pool_release_buffer, buf, 0);
         if (ret) {
+            buf->buffer.flags |= BUFFER_FLAG_NO_FREE;
             pool->pool = buf->next;
             buf->next = NULL;
         }
@@ -425,3 +442,31 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
 
     return ret;
 }
+
+int av_buffer_pool_prealloc(AVBufferPool *pool, int nb_buffers)
+{
+    AVBufferRef **bufs;
+    int i, ret = 0;
+
+    if (nb_buffers <= 0)
+        return 0;
+
+    bufs = av_malloc_array(nb_buffers, sizeof(*bufs));
+    if (!bufs)
+        return AVERROR(ENOMEM);
+
+    /* hold all of them at once so that every one is a distinct buffer,
+     * then hand them back to the pool */
+    for (i = 0; i < nb_buffers; i++) {
+        bufs[i] = av_buffer_pool_get(pool);
+        if (!bufs[i]) {
+            ret = AVERROR(ENOMEM);
+            break;
+        }
+    }
+    while (i--)
+        av_buffer_unref(&bufs[i]);
+
+    av_free(bufs);
+    return ret;
+}
@@ -283,6 +283,17 @@ void av_buffer_pool_uninit(AVBufferPool **pool);
  */
 AVBufferRef *av_buffer_pool_get(AVBufferPool *pool);
 
+/**
+ * Make sure the pool holds at least nb_buffers buffers, allocating the
+ * missing ones now, so that they do not need to be allocated later by
+ * av_buffer_pool_get().
+ * This function may be called simultaneously from multiple threads, but
+ * buffers in use by other threads do not count towards nb_buffers.
+ *
+ * @return 0 on success, a negative AVERROR on failure
+ */
+int av_buffer_pool_prealloc(AVBufferPool *pool, int nb_buffers);
+
 /**
  * @}
  */
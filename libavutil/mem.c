@@ -42,6 +42,7 @@
 #include "dynarray.h"
 #include "intreadwrite.h"
 #include "mem.h"
+#include "thread.h"
 
 #ifdef MALLOC_PREFIX
 
@@ -50,12 +51,14 @@
 #define posix_memalign AV_JOIN(MALLOC_PREFIX, posix_memalign)
 #define realloc        AV_JOIN(MALLOC_PREFIX, realloc)
 #define free           AV_JOIN(MALLOC_PREFIX, free)
+#define malloc_usable_size AV_JOIN(MALLOC_PREFIX, malloc_usable_size)
 
 void *malloc(size_t size);
 void *memalign(size_t align, size_t size);
 int   posix_memalign(void **ptr, size_t align, size_t size);
 void *realloc(void *ptr, size_t size);
 void  free(void *ptr);
+size_t malloc_usable_size(void *ptr);
 
 #endif /* MALLOC_PREFIX */
 
@@ -74,6 +77,78 @@ void av_max_alloc(size_t max){
     max_alloc_size = max;
 }
 
+#if CONFIG_MEMORY_ACCOUNTING
+static size_t mem_allocated, mem_peak, mem_limit;
+
+static AVMutex mem_stats_mutex;
+static AVOnce mem_stats_once = AV_ONCE_INIT;
+
+static void mem_stats_init(void)
+{
+    ff_mutex_init(&mem_stats_mutex, NULL);
+}
+
+#define MEM_STATS_LOCK() do {                           \
+    ff_thread_once(&mem_stats_once, mem_stats_init);    \
+    ff_mutex_lock(&mem_stats_mutex);                    \
+} while (0)
+#define MEM_STATS_UNLOCK() ff_mutex_unlock(&mem_stats_mutex)
+
+/* Account for replacing a block of old_size bytes by one of new_size bytes
+ * before it is allocated. Return 0 without changing anything if this would
+ * exceed the limit set with av_mem_set_limit(). Reserving under the same
+ * lock as the check keeps concurrent allocations from all passing it. */
+static int mem_reserve(size_t old_size, size_t new_size)
+{
+    int ret = 1;
+
+    MEM_STATS_LOCK();
+    if (mem_limit && new_size > old_size &&
+        new_size - old_size > mem_limit - FFMIN(mem_allocated, mem_limit)) {
+        ret = 0;
+    } else {
+        mem_allocated += new_size - old_size;
+    }
+    MEM_STATS_UNLOCK();
+    return ret;
+}
+
+/* Replace a reservation of reserved bytes by the real size of the block,
+ * or by the old size of the block if the allocation failed. The peak is only
+ * updated here, so that failed allocations do not count towards it. */
+static void mem_commit(size_t reserved, size_t size)
+{
+    MEM_STATS_LOCK();
+    mem_allocated += size - reserved;
+    mem_peak       = FFMAX(mem_peak, mem_allocated);
+    MEM_STATS_UNLOCK();
+}
+#endif
+
+void av_mem_set_limit(size_t limit)
+{
+#if CONFIG_MEMORY_ACCOUNTING
+    MEM_STATS_LOCK();
+    mem_limit = limit;
+    MEM_STATS_UNLOCK();
+#endif
+}
+
+int av_mem_get_stats(size_t *allocated, size_t *peak)
+{
+#if CONFIG_MEMORY_ACCOUNTING
+    MEM_STATS_LOCK();
+    if (allocated)
+        *allocated = mem_allocated;
+    if (peak)
+        *peak      = mem_peak;
+    MEM_STATS_UNLOCK();
+    return 0;
+#else
+    return AVERROR(ENOSYS);
+#endif
+}
+
 void *av_malloc(size_t size)
 {
     void *ptr = NULL;
@@ -85,6 +160,11 @@ void *av_malloc(size_t size)
     if (size > (max_alloc_size - 32))
         return NULL;
 
+#if CONFIG_MEMORY_ACCOUNTING
+    if (!mem_reserve(0, size))
+        return NULL;
+#endif
+
 #if CONFIG_MEMALIGN_HACK
     ptr = malloc(size + ALIGN);
     if (!ptr)
@@ -130,6 +210,9 @@ void *av_malloc(size_t size)
      */
 #else
     ptr = malloc(size);
+#endif
+#if CONFIG_MEMORY_ACCOUNTING
+    mem_commit(size, ptr ? malloc_usable_size(ptr) : 0);
 #endif
     if(!ptr && !size) {
         size = 1;
@@ -164,6 +247,16 @@ void *av_realloc(void *ptr, size_t size)
     return ptr;
 #elif HAVE_ALIGNED_MALLOC
     return _aligned_realloc(ptr, size + !size, ALIGN);
+#elif CONFIG_MEMORY_ACCOUNTING
+    {
+        size_t old_size = ptr ? malloc_usable_size(ptr) : 0;
+        void *new_ptr;
+        if (!mem_reserve(old_size, size))
+            return NULL;
+        new_ptr = realloc(ptr, size + !size);
+        mem_commit(size, new_ptr ? malloc_usable_size(new_ptr) : old_size);
+        return new_ptr;
+    }
 #else
     return realloc(ptr, size + !size);
 #endif
@@ -236,6 +329,10 @@ void av_free(void *ptr)
 #elif HAVE_ALIGNED_MALLOC
     _aligned_free(ptr);
 #else
+#if CONFIG_MEMORY_ACCOUNTING
+    if (ptr)
+        mem_commit(malloc_usable_size(ptr), 0);
+#endif
     free(ptr);
 #endif
 }
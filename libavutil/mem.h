@@ -688,6 +688,34 @@ static inline int av_size_mult(size_t a, size_t b, size_t *r)
  */
 void av_max_alloc(size_t max);
 
+/**
+ * Set the maximum total size of the memory that may be allocated at once
+ * with libavutil's @ref lavu_mem_funcs "heap management functions."
+ * Allocations which would exceed it fail as if the system was out of memory.
+ *
+ * This only has an effect if FFmpeg was configured with
+ * `--enable-memory-accounting`.
+ *
+ * @param limit maximum number of bytes, 0 (the default) means no limit
+ */
+void av_mem_set_limit(size_t limit);
+
+/**
+ * Get the memory usage of libavutil's @ref lavu_mem_funcs
+ * "heap management functions," summed over the whole process.
+ *
+ * The sizes are those reported by the system allocator, so they may be
+ * slightly larger than the requested ones.
+ *
+ * @param[out] allocated if not NULL, set to the number of bytes currently
+ *                       allocated
+ * @param[out] peak      if not NULL, set to the largest number of bytes
+ *                       allocated at any point so far
+ * @return 0 on success, AVERROR(ENOSYS) if FFmpeg was not configured with
+ *         `--enable-memory-accounting`
+ */
+int av_mem_get_stats(size_t *allocated, size_t *peak);
+
 /**
  * @}
  * @}
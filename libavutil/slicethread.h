@@ -0,0 +1,53 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVUTIL_SLICETHREAD_H
+#define AVUTIL_SLICETHREAD_H
+
+typedef struct AVSliceThread AVSliceThread;
+
+/**
+ * Create a pool of worker threads, which split the jobs of every
+ * avpriv_slicethread_execute() call between them.
+ *
+ * @param pctx        set to the new pool, or to NULL if none was created
+ * @param priv        opaque pointer passed to worker_func
+ * @param worker_func function called for each job, with jobnr in [0, nb_jobs)
+ * @param nb_threads  number of threads to start, 0 to pick it from the
+ *                    number of CPUs
+ * @return the number of threads started, 1 if no pool was created because
+ *         a single thread was asked for or only one CPU is available,
+ *         a negative AVERROR code on failure; AVERROR(ENOSYS) if FFmpeg was
+ *         built without thread support
+ */
+int avpriv_slicethread_create(AVSliceThread **pctx, void *priv,
+                              void (*worker_func)(void *priv, int jobnr, int nb_jobs),
+                              int nb_threads);
+
+/**
+ * Run nb_jobs jobs on the worker threads and wait until all of them are
+ * done. Must not be called from several threads at the same time.
+ */
+void avpriv_slicethread_execute(AVSliceThread *ctx, int nb_jobs);
+
+/**
+ * Stop the worker threads and free the pool. *pctx may be NULL.
+ */
+void avpriv_slicethread_free(AVSliceThread **pctx);
+
+#endif /* AVUTIL_SLICETHREAD_H */
@@ -0,0 +1,93 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Libswresample multithreading support, splitting the per channel
+ * processing stages into jobs
+ */
+
+#include "config.h"
+
+#include "libavutil/common.h"
+#include "libavutil/mem.h"
+#include "libavutil/slicethread.h"
+
+#include "swresample_internal.h"
+
+typedef struct SwrThreadContext {
+    AVSliceThread *thread;
+    swri_job_func *func;
+
+    /* per-execute parameters */
+    SwrContext *s;
+    void *arg;
+} SwrThreadContext;
+
+static void worker_func(void *priv, int jobnr, int nb_jobs)
+{
+    SwrThreadContext *c = priv;
+    c->func(c->s, c->arg, jobnr, nb_jobs);
+}
+
+int swri_thread_execute(SwrContext *s, swri_job_func *func, void *arg, int nb_jobs)
+{
+    SwrThreadContext *c = s->thread;
+
+    if (nb_jobs <= 0)
+        return 0;
+
+    c->s    = s;
+    c->arg  = arg;
+    c->func = func;
+
+    avpriv_slicethread_execute(c->thread, nb_jobs);
+
+    return 0;
+}
+
+int swri_thread_init(SwrContext *s)
+{
+    SwrThreadContext *c;
+    int ret;
+
+    s->active_threads = 1;
+    if (s->nb_threads == 1)
+        return 0;
+
+    s->thread = c = av_mallocz(sizeof(SwrThreadContext));
+    if (!c)
+        return AVERROR(ENOMEM);
+
+    ret = avpriv_slicethread_create(&c->thread, c, worker_func, s->nb_threads);
+    if (ret <= 1) {
+        av_freep(&s->thread);
+        return (ret < 0) ? ret : 0;
+    }
+    s->active_threads = ret;
+
+    return 0;
+}
+
+void swri_thread_free(SwrContext *s)
+{
+    if (s->thread)
+        avpriv_slicethread_free(&s->thread->thread);
+    av_freep(&s->thread);
+    s->active_threads = 1;
+}
@@ -482,25 +482,22 @@ av_cold void swri_rematrix_free(SwrContext *s){
     av_freep(&s->native_simd_one);
 }
 
-int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mustcopy){
-    int out_i, in_i, i, j;
-    int len1 = 0;
-    int off = 0;
-
-    if(s->mix_any_f) {
-        s->mix_any_f(out->ch, (const uint8_t **)in->ch, s->native_matrix, len);
-        return 0;
-    }
+typedef struct RematrixThreadData {
+    AudioData *out, *in;
+    int len, len1, off;
+    int mustcopy;
+} RematrixThreadData;
 
-    if(s->mix_2_1_simd || s->mix_1_1_simd){
-        len1= len&~15;
-        off = len1 * out->bps;
-    }
-
-    av_assert0(!s->out_ch_layout || out->ch_count == av_get_channel_layout_nb_channels(s->out_ch_layout));
-    av_assert0(!s-> in_ch_layout || in ->ch_count == av_get_channel_layout_nb_channels(s-> in_ch_layout));
+static int rematrix_channels(SwrContext *s, void *arg, int jobnr, int nb_jobs)
+{
+    RematrixThreadData *td = arg;
+    AudioData *out = td->out, *in = td->in;
+    int len = td->len, len1 = td->len1, off = td->off, mustcopy = td->mustcopy;
+    int start = (out->ch_count *  jobnr     ) / nb_jobs;
+    int end   = (out->ch_count * (jobnr + 1)) / nb_jobs;
+    int out_i, in_i, i, j;
 
-    for(out_i=0; out_i<out->ch_count; out_i++){
+    for(out_i=start; out_i<end; out_i++){
         switch(s->matrix_ch[out_i][0]){
         case 0:
             if(mustcopy)
@@ -562,3 +559,26 @@ int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mus
     }
     return 0;
 }
+
+int swri_rematrix(SwrContext *s, AudioData *out, AudioData *in, int len, int mustcopy){
+    RematrixThreadData td = { out, in, len, 0, 0, mustcopy };
+
+    if(s->mix_any_f) {
+        s->mix_any_f(out->ch, (const uint8_t **)in->ch, s->native_matrix, len);
+        return 0;
+    }
+
+    if(s->mix_2_1_simd || s->mix_1_1_simd){
+        td.len1= len&~15;
+        td.off = td.len1 * out->bps;
+    }
+
+    av_assert0(!s->out_ch_layout || out->ch_count == av_get_channel_layout_nb_channels(s->out_ch_layout));
+    av_assert0(!s-> in_ch_layout || in ->ch_count == av_get_channel_layout_nb_channels(s-> in_ch_layout));
+
+    /* every output channel only depends on the input, so splitting them
+     * between jobs gives the same result as a single pass */
+    swri_execute(s, rematrix_channels, &td,
+                 FFMIN(s->active_threads, out->ch_count));
+    return 0;
+}
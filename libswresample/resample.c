@@ -505,8 +505,34 @@ static int swri_resample(ResampleContext *c,
     return dst_size;
 }
 
-static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
-    int i, ret= -1;
+typedef struct ResampleThreadData {
+    ResampleContext *c;
+    AudioData *dst, *src;
+    int nb_channels;
+    int dst_size, src_size;
+    int need_emms;
+} ResampleThreadData;
+
+static int resample_channels(SwrContext *s, void *arg, int jobnr, int nb_jobs)
+{
+    ResampleThreadData *td = arg;
+    int start = (td->nb_channels *  jobnr     ) / nb_jobs;
+    int end   = (td->nb_channels * (jobnr + 1)) / nb_jobs;
+    int i, consumed;
+
+    for (i = start; i < end; i++)
+        swri_resample(td->c, td->dst->ch[i], td->src->ch[i],
+                      &consumed, td->src_size, td->dst_size, 0);
+    if (td->need_emms)
+        emms_c();
+
+    return 0;
+}
+
+static int multiple_resample(SwrContext *s, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed){
+    ResampleContext *c = s->resample;
+    ResampleThreadData td;
+    int ret;
     int av_unused mm_flags = av_get_cpu_flags();
     int need_emms = c->format == AV_SAMPLE_FMT_S16P && ARCH_X86_32 &&
                     (mm_flags & (AV_CPU_FLAG_MMX2 | AV_CPU_FLAG_SSE2)) == AV_CPU_FLAG_MMX2;
@@ -516,10 +542,20 @@ static int multiple_resample(ResampleContext *c, AudioData *dst, int dst_size, A
         dst_size = FFMIN(dst_size, c->compensation_distance);
     src_size = FFMIN(src_size, max_src_size);
 
-    for(i=0; i<dst->ch_count; i++){
-        ret= swri_resample(c, dst->ch[i], src->ch[i],
-                           consumed, src_size, dst_size, i+1==dst->ch_count);
-    }
+    /* all channels but the last one leave the context untouched, so they
+     * can run in parallel; the last one then updates the context */
+    td.c           = c;
+    td.dst         = dst;
+    td.src         = src;
+    td.nb_channels = dst->ch_count - 1;
+    td.dst_size    = dst_size;
+    td.src_size    = src_size;
+    td.need_emms   = need_emms;
+    swri_execute(s, resample_channels, &td,
+                 FFMIN(s->active_threads, td.nb_channels));
+
+    ret= swri_resample(c, dst->ch[dst->ch_count - 1], src->ch[dst->ch_count - 1],
+                       consumed, src_size, dst_size, 1);
     if(need_emms)
         emms_c();
 
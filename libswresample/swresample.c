@@ -132,11 +132,28 @@ static void clear_context(SwrContext *s){
     swri_audio_convert_free(&s->out_convert);
     swri_audio_convert_free(&s->full_convert);
     swri_rematrix_free(s);
+#if HAVE_THREADS
+    swri_thread_free(s);
+#endif
 
+    s->active_threads = 1;
     s->delayed_samples_fixup = 0;
     s->flushed = 0;
 }
 
+int swri_execute(SwrContext *s, swri_job_func *func, void *arg, int nb_jobs)
+{
+    int i;
+
+#if HAVE_THREADS
+    if (s->thread && nb_jobs > 1)
+        return swri_thread_execute(s, func, arg, nb_jobs);
+#endif
+    for (i = 0; i < nb_jobs; i++)
+        func(s, arg, i, nb_jobs);
+    return 0;
+}
+
 av_cold void swr_free(SwrContext **ss){
     SwrContext *s= *ss;
     if(s){
@@ -383,6 +400,11 @@ av_assert0(s->out.ch_count);
             goto fail;
     }
 
+#if HAVE_THREADS
+    if ((ret = swri_thread_init(s)) < 0)
+        goto fail;
+#endif
+
     return 0;
 fail:
     swr_close(s);
@@ -507,7 +529,7 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
         int ret, size, consumed;
         if(!s->resample_in_constraint && s->in_buffer_count){
             buf_set(&tmp, &s->in_buffer, s->in_buffer_index);
-            ret= s->resampler->multiple_resample(s->resample, &out, out_count, &tmp, s->in_buffer_count, &consumed);
+            ret= s->resampler->multiple_resample(s, &out, out_count, &tmp, s->in_buffer_count, &consumed);
             out_count -= ret;
             ret_sum += ret;
             buf_set(&out, &out, ret);
@@ -527,7 +549,7 @@ static int resample(SwrContext *s, AudioData *out_param, int out_count,
 
         if((s->flushed || in_count > padless) && !s->in_buffer_count){
             s->in_buffer_index=0;
-            ret= s->resampler->multiple_resample(s->resample, &out, out_count, &in, FFMAX(in_count-padless, 0), &consumed);
+            ret= s->resampler->multiple_resample(s, &out, out_count, &in, FFMAX(in_count-padless, 0), &consumed);
             out_count -= ret;
             ret_sum += ret;
             buf_set(&out, &out, ret);
@@ -71,7 +71,7 @@ struct DitherContext {
 typedef struct ResampleContext * (* resample_init_func)(struct ResampleContext *c, int out_rate, int in_rate, int filter_size, int phase_shift, int linear,
                                     double cutoff, enum AVSampleFormat format, enum SwrFilterType filter_type, double kaiser_beta, double precision, int cheby, int exact_rational);
 typedef void    (* resample_free_func)(struct ResampleContext **c);
-typedef int     (* multiple_resample_func)(struct ResampleContext *c, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed);
+typedef int     (* multiple_resample_func)(struct SwrContext *s, AudioData *dst, int dst_size, AudioData *src, int src_size, int *consumed);
 typedef int     (* resample_flush_func)(struct SwrContext *c);
 typedef int     (* set_compensation_func)(struct ResampleContext *c, int sample_delta, int compensation_distance);
 typedef int64_t (* get_delay_func)(struct SwrContext *s, int64_t base);
@@ -113,6 +113,7 @@ struct SwrContext {
     const int *channel_map;                         ///< channel index (or -1 if muted channel) map
     int used_ch_count;                              ///< number of used input channels (mapped channel count if channel_map, otherwise in.ch_count)
     int engine;
+    int nb_threads;                                 ///< number of threads for the per channel processing, 0 for automatic
 
     int user_in_ch_count;                           ///< User set input channel count
     int user_out_ch_count;                          ///< User set output channel count
@@ -167,6 +168,8 @@ struct SwrContext {
     struct AudioConvert *full_convert;              ///< full conversion context (single conversion for input and output)
     struct ResampleContext *resample;               ///< resampling context
     struct Resampler const *resampler;              ///< resampler virtual function table
+    struct SwrThreadContext *thread;                ///< worker threads, NULL if all processing is done by the calling thread
+    int active_threads;                             ///< number of worker threads actually running, 1 if none
 
     double matrix[SWR_CH_MAX][SWR_CH_MAX];          ///< floating point rematrixing coefficients
     float matrix_flt[SWR_CH_MAX][SWR_CH_MAX];       ///< single precision floating point rematrixing coefficients
@@ -195,6 +198,23 @@ void swri_noise_shaping_int32 (SwrContext *s, AudioData *dsts, const AudioData *
 void swri_noise_shaping_float (SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
 void swri_noise_shaping_double(SwrContext *s, AudioData *dsts, const AudioData *srcs, const AudioData *noises, int count);
 
+/**
+ * A job of swri_execute(), processing the part jobnr of nb_jobs of the data
+ * described by arg.
+ */
+typedef int (swri_job_func)(SwrContext *s, void *arg, int jobnr, int nb_jobs);
+
+/**
+ * Run func for nb_jobs jobs, in parallel if worker threads were started,
+ * and return once all of them are done.
+ */
+int swri_execute(SwrContext *s, swri_job_func *func, void *arg, int nb_jobs);
+
+av_warn_unused_result
+int swri_thread_init(SwrContext *s);
+void swri_thread_free(SwrContext *s);
+int swri_thread_execute(SwrContext *s, swri_job_func *func, void *arg, int nb_jobs);
+
 av_warn_unused_result
 int swri_rematrix_init(SwrContext *s);
 void swri_rematrix_free(SwrContext *s);
@@ -58,6 +58,12 @@ fate-filter-acrossfade: SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
 fate-filter-acrossfade: SRC2 = $(TARGET_SAMPLES)/audio-reference/luckynight_2ch_44kHz_s16.wav
 fate-filter-acrossfade: CMD = framecrc -i $(SRC) -i $(SRC2) -filter_complex acrossfade=d=2:c1=log:c2=exp
 
+FATE_AFILTER-$(call FILTERDEMDECENCMUX, AFIR AEVALSRC ADELAY AMERGE PAN VOLUME, WAV, PCM_S16LE, PCM_S16LE, WAV) += fate-filter-afir
+fate-filter-afir: tests/data/asynth-44100-2.wav
+fate-filter-afir: tests/data/filtergraphs/afir
+fate-filter-afir: SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
+fate-filter-afir: CMD = framecrc -i $(SRC) -aframes 20 -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/afir
+
 FATE_AFILTER-$(call FILTERDEMDECENCMUX, AFADE, WAV, PCM_S16LE, PCM_S16LE, WAV) += fate-filter-agate
 fate-filter-agate: tests/data/asynth-44100-2.wav
 fate-filter-agate: SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
@@ -94,6 +100,12 @@ fate-filter-asetrate: tests/data/asynth-44100-2.wav
 fate-filter-asetrate: SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
 fate-filter-asetrate: CMD = framecrc -i $(SRC) -aframes 20 -af asetrate=20000
 
+FATE_AFILTER-$(call FILTERDEMDECENCMUX, BIQUADCHAIN, WAV, PCM_S16LE, PCM_S16LE, WAV) += fate-filter-biquadchain
+fate-filter-biquadchain: tests/data/asynth-44100-2.wav
+fate-filter-biquadchain: tests/data/filtergraphs/biquadchain
+fate-filter-biquadchain: SRC = $(TARGET_PATH)/tests/data/asynth-44100-2.wav
+fate-filter-biquadchain: CMD = framecrc -i $(SRC) -filter_complex_script $(TARGET_PATH)/tests/data/filtergraphs/biquadchain
+
 FATE_AFILTER-$(call FILTERDEMDECENCMUX, CHORUS, WAV, PCM_S16LE, PCM_S16LE, WAV) += fate-filter-chorus
 fate-filter-chorus: tests/data/asynth-22050-1.wav
 fate-filter-chorus: SRC = $(TARGET_PATH)/tests/data/asynth-22050-1.wav